@@ -16,50 +16,132 @@
    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <charconv>
 #include "board.h"
 
 namespace Chess {
-    Board::Board(const std::string &fen) : pieceBB{0}, board{}, stm(WHITE), gamePly(0), hash(0),
-                                           checkers(0), pinned(0), danger(0), captureMask(0), quietMask(0) {
-        for (auto &i: board) { i = NO_PIECE; }
-        history[0] = StateInfo();
+    Board::Board(const std::string &fen) : checkers(0), pinned(0), danger(0), captureMask(0), quietMask(0),
+                                           pieceBB{0}, board{}, stm(WHITE), gamePly(0), plyOffset(0), hash(0),
+                                           pawnHash(0), psqMg(0), psqEg(0), materialHash(0), pieceCounts{0} {
+        if (!setFen(fen)) {
+            std::cerr << "Error: invalid fen " << fen << ", using the start position" << std::endl;
+            setFen(DEFAULT_FEN);
+        }
+    }
 
-        int square = a8;
-        for (const char ch: fen.substr(0, fen.find(' '))) {
-            if (isdigit(ch)) {
-                square += ch - '0';
-            } else if (ch == '/') {
-                square -= 16;
+    bool Board::setFen(std::string_view fen) {
+        Piece squares[NUM_SQUARES];
+        int numKings[NUM_COLORS] = {0, 0};
+        std::size_t i = 0;
+
+        // piece placement from a8 to h1, every rank has to add up to eight files
+        int rank = RANK_8, file = FILE_A;
+        for (; i < fen.size() && fen[i] != ' '; ++i) {
+            const char ch = fen[i];
+
+            if (ch == '/') {
+                if (file != 8 || rank == RANK_1) return false;
+                rank--;
+                file = FILE_A;
+            } else if (ch >= '1' && ch <= '8') {
+                if (file + ch - '0' > 8) return false;
+                for (int n = ch - '0'; n > 0; --n) {
+                    squares[rank * 8 + file++] = NO_PIECE;
+                }
             } else {
-                putPiece((Piece)PIECE_STR.find(ch), (Square)square++);
+                const Piece pc = fenPiece(ch);
+                if (pc == NO_PIECE || file == 8) return false;
+                if (typeOfPiece(pc) == KING) numKings[colorOfPiece(pc)]++;
+                squares[rank * 8 + file++] = pc;
+            }
+        }
+
+        if (rank != RANK_1 || file != 8 || numKings[WHITE] != 1 || numKings[BLACK] != 1) {
+            return false;
+        }
+
+        // side to move, castling, en passant, halfmove clock and fullmove number,
+        // missing fields at the end keep their defaults
+        std::string_view fields[5];
+        for (auto &field: fields) {
+            while (i < fen.size() && fen[i] == ' ') i++;
+            const std::size_t begin = i;
+            while (i < fen.size() && fen[i] != ' ') i++;
+            field = fen.substr(begin, i - begin);
+        }
+
+        if (fields[0] != "w" && fields[0] != "b") {
+            return false;
+        }
+
+        U64 castleMask = ALL_CASTLING_MASK;
+        if (fields[1] != "-") {
+            for (const char ch: fields[1]) {
+                switch (ch) {
+                    case 'K':
+                        castleMask &= ~WHITE_OO_MASK;
+                        break;
+                    case 'Q':
+                        castleMask &= ~WHITE_OOO_MASK;
+                        break;
+                    case 'k':
+                        castleMask &= ~BLACK_OO_MASK;
+                        break;
+                    case 'q':
+                        castleMask &= ~BLACK_OOO_MASK;
+                        break;
+                    default:
+                        return false;
+                }
+            }
+        }
+
+        Square epSquare = NO_SQUARE;
+        if (!fields[2].empty() && fields[2] != "-") {
+            // the square behind a pawn which just moved two squares, so rank 6 if white is to move
+            const std::string_view ep = fields[2];
+            if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || ep[1] != (fields[0] == "w" ? '6' : '3')) {
+                return false;
             }
+            epSquare = Square((ep[1] - '1') * 8 + ep[0] - 'a');
+        }
+
+        const auto parseNumber = [](std::string_view field, int &value) {
+            if (field.empty()) return true;
+            const auto res = std::from_chars(field.data(), field.data() + field.size(), value);
+            return res.ec == std::errc() && res.ptr == field.data() + field.size() && value >= 0;
+        };
+
+        int halfMoveClock = 0, fullMoveNumber = 1;
+        if (!parseNumber(fields[3], halfMoveClock) || !parseNumber(fields[4], fullMoveNumber)) {
+            return false;
         }
 
-        std::istringstream ss(fen.substr(fen.find(' ')));
-        char token;
-
-        ss >> token;
-        stm = token == 'w' ? WHITE : BLACK;
-
-        history[gamePly].castleMask = ALL_CASTLING_MASK;
-        while (ss >> token && !isspace(token)) {
-            switch (token) {
-                case 'K':
-                    history[gamePly].castleMask &= ~WHITE_OO_MASK;
-                    break;
-                case 'Q':
-                    history[gamePly].castleMask &= ~WHITE_OOO_MASK;
-                    break;
-                case 'k':
-                    history[gamePly].castleMask &= ~BLACK_OO_MASK;
-                    break;
-                case 'q':
-                    history[gamePly].castleMask &= ~BLACK_OOO_MASK;
-                    break;
-                default:
-                    break;
+        // the fen is valid, set up the position
+        std::fill(std::begin(pieceBB), std::end(pieceBB), 0);
+        std::fill(std::begin(board), std::end(board), NO_PIECE);
+        std::fill(std::begin(pieceCounts), std::end(pieceCounts), 0);
+        hash = pawnHash = materialHash = 0;
+        psqMg = psqEg = 0;
+        checkers = pinned = danger = captureMask = quietMask = 0;
+
+        stm = fields[0] == "w" ? WHITE : BLACK;
+        gamePly = 0;
+        plyOffset = 2 * (std::max(fullMoveNumber, 1) - 1) + (stm == BLACK);
+
+        for (Square s = a1; s <= h8; ++s) {
+            if (squares[s] != NO_PIECE) {
+                putPiece(squares[s], s);
             }
         }
+
+        history[0] = StateInfo();
+        history[0].castleMask = castleMask;
+        history[0].epSquare = epSquare;
+        history[0].halfMoveClock = halfMoveClock;
+        history[0].hash = hash;
+
+        return true;
     }
 
     void Board::print(Color c) {
@@ -81,37 +163,67 @@ namespace Chess {
         std::cout << "Fen: " << fen() << "\n\n";
     }
 
-    std::string Board::fen() const {
-        std::ostringstream fen;
+    int Board::writeFen(char *out) const {
+        char *p = out;
 
-        for (int i = 56; i >= 0; i -= 8) {
+        for (int r = RANK_8; r >= RANK_1; --r) {
             int empty = 0;
 
-            for (int j = 0; j < 8; j++) {
-                Piece p = board[i + j];
+            for (int f = FILE_A; f <= FILE_H; ++f) {
+                const Piece pc = board[r * 8 + f];
 
-                if (p == NO_PIECE) {
+                if (pc == NO_PIECE) {
                     empty++;
                 } else {
-                    fen << (empty == 0 ? "" : std::to_string(empty)) << PIECE_STR[p];
+                    if (empty != 0) *p++ = char('0' + empty);
+                    *p++ = PIECE_STR[pc];
                     empty = 0;
                 }
             }
 
-            if (empty != 0) fen << empty;
-            if (i > 0) fen << '/';
+            if (empty != 0) *p++ = char('0' + empty);
+            if (r > RANK_1) *p++ = '/';
         }
 
-        fen << (stm == WHITE ? " w " : " b ")
-            << (history[gamePly].castleMask & WHITE_OO_MASK ? "" : "K")
-            << (history[gamePly].castleMask & WHITE_OOO_MASK ? "" : "Q")
-            << (history[gamePly].castleMask & BLACK_OO_MASK ? "" : "k")
-            << (history[gamePly].castleMask & BLACK_OOO_MASK ? "" : "q")
-            << (castleNotationHelper(fen) ? " " : "- ")
-            << (history[gamePly].epSquare == NO_SQUARE ? "-" : SQSTR[history[gamePly].epSquare]);
+        const StateInfo &st = history[gamePly];
+
+        *p++ = ' ';
+        *p++ = stm == WHITE ? 'w' : 'b';
+        *p++ = ' ';
+
+        const char *castling = p;
+        if (!(st.castleMask & WHITE_OO_MASK)) *p++ = 'K';
+        if (!(st.castleMask & WHITE_OOO_MASK)) *p++ = 'Q';
+        if (!(st.castleMask & BLACK_OO_MASK)) *p++ = 'k';
+        if (!(st.castleMask & BLACK_OOO_MASK)) *p++ = 'q';
+        if (p == castling) *p++ = '-';
+
+        *p++ = ' ';
+        if (st.epSquare == NO_SQUARE) {
+            *p++ = '-';
+        } else {
+            *p++ = char('a' + st.epSquare % 8);
+            *p++ = char('1' + st.epSquare / 8);
+        }
+
+        *p++ = ' ';
+        p = std::to_chars(p, out + MAX_FEN_LENGTH, st.halfMoveClock).ptr;
+        *p++ = ' ';
+        p = std::to_chars(p, out + MAX_FEN_LENGTH, fullMoveNumber()).ptr;
+        *p = '\0';
+
+        return int(p - out);
+    }
 
-        fen << " " << history[gamePly].halfMoveClock << " " << gamePly;
-        return fen.str();
+    void Board::resetHistory() {
+        char fen[MAX_FEN_LENGTH];
+        writeFen(fen);
+        setFen(fen);
+    }
+
+    std::string Board::fen() const {
+        char buffer[MAX_FEN_LENGTH];
+        return {buffer, std::size_t(writeFen(buffer))};
     }
 
     bool Board::nonPawnMat(Color c) const {
@@ -154,11 +266,52 @@ namespace Chess {
                      getAttacks(ROOK, s, occ) & (pieceBB[BLACK_ROOK] | pieceBB[BLACK_QUEEN]);
     }
 
+    // returns all squares attacked by the pieces of the given color, computed setwise
+    U64 Board::attackMap(Color c, U64 occ) const {
+        return pawnAttacksBB(c, pieceBitboard(c, PAWN)) |
+               knightAttacksBB(pieceBitboard(c, KNIGHT)) |
+               sliderAttacksBB(orthSliders(c), diagSliders(c), occ) |
+               kingAttacksBB(pieceBitboard(c, KING));
+    }
+
     bool Board::inCheck() const {
         U64 pieces = occupancy(WHITE) | occupancy(BLACK);
         return isAttacked(~stm, kingSquare(stm), pieces);
     }
 
+    // computes the hash of the position after the move without making it,
+    // so the transposition table entry of the child can be prefetched early
+    U64 Board::keyAfter(const Move &move) const {
+        const MoveFlags mf = move.flags();
+        const Square from = move.from();
+        const Square to = move.to();
+        const Piece pcFrom = board[from];
+        const Piece pcTo = board[to];
+
+        U64 key = hash ^ zobrist::zobristTable[pcFrom][from];
+
+        if (pcTo != NO_PIECE) {
+            key ^= zobrist::zobristTable[pcTo][to];
+        }
+
+        if (mf >= PR_KNIGHT && mf <= PC_QUEEN) {
+            return key ^ zobrist::zobristTable[makePiece(stm, typeOfPromotion(mf))][to];
+        }
+
+        key ^= zobrist::zobristTable[pcFrom][to];
+
+        if (mf == EN_PASSANT) {
+            key ^= zobrist::zobristTable[makePiece(~stm, PAWN)][to ^ 8];
+        } else if (mf == OO || mf == OOO) {
+            const Piece rook = makePiece(stm, ROOK);
+            const Square rookFrom = mf == OO ? relativeSquare(stm, h1) : relativeSquare(stm, a1);
+            const Square rookTo = mf == OO ? relativeSquare(stm, f1) : relativeSquare(stm, d1);
+            key ^= zobrist::zobristTable[rook][rookFrom] ^ zobrist::zobristTable[rook][rookTo];
+        }
+
+        return key;
+    }
+
     void Board::makeMove(const Move &move) {
         const MoveFlags mf = move.flags();
         const Square from = move.from();
@@ -177,12 +330,16 @@ namespace Chess {
             history[gamePly].halfMoveClock = 0;
         }
 
+        StateInfo &st = history[gamePly];
+
         if (mf == QUIET || mf == DOUBLE_PUSH || mf == EN_PASSANT) {
+            st.addDirty(pcFrom, from, to);
             movePiece(from, to);
 
             if (mf == DOUBLE_PUSH) {
                 history[gamePly].epSquare = Square(to ^ 8);
             } else if (mf == EN_PASSANT) {
+                st.addDirty(board[to ^ 8], Square(to ^ 8), NO_SQUARE);
                 removePiece(Square(to ^ 8));
             }
         } else if (mf == OO || mf == OOO) {
@@ -196,22 +353,40 @@ namespace Chess {
                 rookTo = stm == WHITE ? d1 : d8;
             }
 
+            st.addDirty(pcFrom, from, to);
+            st.addDirty(board[rookFrom], rookFrom, rookTo);
             movePiece(from, to);
             movePiece(rookFrom, rookTo);
         } else if (mf >= PR_KNIGHT && mf <= PC_QUEEN) {
+            const Piece promoted = makePiece(stm, typeOfPromotion(mf));
+
+            st.addDirty(pcFrom, from, NO_SQUARE);
             removePiece(from);
 
             if (mf >= PC_KNIGHT) {
                 history[gamePly].captured = pcTo;
+                st.addDirty(pcTo, to, NO_SQUARE);
                 removePiece(to);
             }
 
-            putPiece(makePiece(stm, typeOfPromotion(mf)), to);
+            st.addDirty(promoted, NO_SQUARE, to);
+            putPiece(promoted, to);
         } else if (mf == CAPTURE) {
+            st.addDirty(pcFrom, from, to);
+            st.addDirty(pcTo, to, NO_SQUARE);
             history[gamePly].captured = pcTo;
             hash ^= zobrist::zobristTable[pcFrom][from] ^
                     zobrist::zobristTable[pcFrom][to] ^
                     zobrist::zobristTable[pcTo][to];
+            if (typeOfPiece(pcFrom) == PAWN) {
+                pawnHash ^= zobrist::zobristTable[pcFrom][from] ^ zobrist::zobristTable[pcFrom][to];
+            }
+            if (typeOfPiece(pcTo) == PAWN) {
+                pawnHash ^= zobrist::zobristTable[pcTo][to];
+            }
+            psqMg += Eval::PSQ.mg[pcFrom][to] - Eval::PSQ.mg[pcFrom][from] - Eval::PSQ.mg[pcTo][to];
+            psqEg += Eval::PSQ.eg[pcFrom][to] - Eval::PSQ.eg[pcFrom][from] - Eval::PSQ.eg[pcTo][to];
+            materialHash ^= zobrist::zobristTable[pcTo][--pieceCounts[pcTo]];
             pieceBB[pcFrom] ^= mask;
             pieceBB[pcTo] &= ~mask;
             board[to] = pcFrom;
@@ -287,11 +462,11 @@ namespace Chess {
     }
 
     bool Board::isInsufficientMat() const {
-        const U64 pawns = pieceBB[WHITE_PAWN] | pieceBB[BLACK_PAWN];
-        const U64 queens = pieceBB[WHITE_QUEEN] | pieceBB[BLACK_QUEEN];
-        const U64 rooks = pieceBB[WHITE_ROOK] | pieceBB[BLACK_ROOK];
-        const int numWhiteMinorPieces = popCount(pieceBB[WHITE_KNIGHT] | pieceBB[WHITE_BISHOP]);
-        const int numBlackMinorPieces = popCount(pieceBB[BLACK_KNIGHT] | pieceBB[BLACK_BISHOP]);
+        const int pawns = pieceCounts[WHITE_PAWN] + pieceCounts[BLACK_PAWN];
+        const int queens = pieceCounts[WHITE_QUEEN] + pieceCounts[BLACK_QUEEN];
+        const int rooks = pieceCounts[WHITE_ROOK] + pieceCounts[BLACK_ROOK];
+        const int numWhiteMinorPieces = pieceCounts[WHITE_KNIGHT] + pieceCounts[WHITE_BISHOP];
+        const int numBlackMinorPieces = pieceCounts[BLACK_KNIGHT] + pieceCounts[BLACK_BISHOP];
         // draw when KvK, KvK+B, KvK+N, K+NvK+N, K+BvK+B
         return !pawns && !queens && !rooks && numWhiteMinorPieces <= 1 && numBlackMinorPieces <= 1;
     }
@@ -303,27 +478,44 @@ namespace Chess {
     /*
      * PRIVATE FUNCTIONS
      */
-    // puts a piece on the board and updates the hash and pieces bitboards
+    // puts a piece on the board and updates the hashes, scores, piece counts and pieces bitboards
     void Board::putPiece(Piece pc, Square s) {
         board[s] = pc;
         pieceBB[pc] |= SQUARE_BB[s];
         hash ^= zobrist::zobristTable[pc][s];
+        if (typeOfPiece(pc) == PAWN) {
+            pawnHash ^= zobrist::zobristTable[pc][s];
+        }
+        psqMg += Eval::PSQ.mg[pc][s];
+        psqEg += Eval::PSQ.eg[pc][s];
+        materialHash ^= zobrist::zobristTable[pc][pieceCounts[pc]++];
     }
 
-    // removes a piece from the board and updates the hash and pieces bitboards
+    // removes a piece from the board and updates the hashes, scores, piece counts and pieces bitboards
     void Board::removePiece(Square s) {
         Piece pc = board[s];
 
         hash ^= zobrist::zobristTable[pc][s];
+        if (typeOfPiece(pc) == PAWN) {
+            pawnHash ^= zobrist::zobristTable[pc][s];
+        }
+        psqMg -= Eval::PSQ.mg[pc][s];
+        psqEg -= Eval::PSQ.eg[pc][s];
+        materialHash ^= zobrist::zobristTable[pc][--pieceCounts[pc]];
         pieceBB[pc] &= ~SQUARE_BB[s];
         board[s] = NO_PIECE;
     }
 
-    // moves a piece on the board and updates the hash and pieces bitboards
+    // moves a piece on the board and updates the hash, scores and pieces bitboards
     void Board::movePiece(Square from, Square to) {
         Piece pc = board[from];
 
         hash ^= zobrist::zobristTable[pc][from] ^ zobrist::zobristTable[pc][to];
+        if (typeOfPiece(pc) == PAWN) {
+            pawnHash ^= zobrist::zobristTable[pc][from] ^ zobrist::zobristTable[pc][to];
+        }
+        psqMg += Eval::PSQ.mg[pc][to] - Eval::PSQ.mg[pc][from];
+        psqEg += Eval::PSQ.eg[pc][to] - Eval::PSQ.eg[pc][from];
         pieceBB[pc] ^= (SQUARE_BB[from] | SQUARE_BB[to]);
         board[to] = pc;
         board[from] = NO_PIECE;
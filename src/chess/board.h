@@ -19,11 +19,25 @@
 #ifndef ASTRA_BOARD_H
 #define ASTRA_BOARD_H
 
+#include <string_view>
 #include "zobrist.h"
 #include "attacks.h"
+#include "fills.h"
+#include "../eval/pesto.h"
 
 namespace Chess {
 
+    // enough for any fen written by Board::writeFen, including the null character
+    constexpr int MAX_FEN_LENGTH = 128;
+
+    // a piece which changed with the last move, from is NO_SQUARE
+    // if the piece was added and to is NO_SQUARE if it was removed
+    struct DirtyPiece {
+        Piece pc;
+        Square from;
+        Square to;
+    };
+
     struct StateInfo {
         U64 hash;
         Piece captured;
@@ -31,7 +45,12 @@ namespace Chess {
         U64 castleMask;
         int halfMoveClock;
 
-        StateInfo() : hash(0), captured(NO_PIECE), epSquare(NO_SQUARE), castleMask(0), halfMoveClock(0) {}
+        // pieces changed by the move which led to this position,
+        // used to update the network accumulators lazily
+        DirtyPiece dirtyPieces[3];
+        int numDirty;
+
+        StateInfo() : hash(0), captured(NO_PIECE), epSquare(NO_SQUARE), castleMask(0), halfMoveClock(0), numDirty(0) {}
 
         StateInfo(const StateInfo &prev) {
             hash = prev.hash;
@@ -39,6 +58,11 @@ namespace Chess {
             epSquare = NO_SQUARE;
             castleMask = prev.castleMask;
             halfMoveClock = prev.halfMoveClock;
+            numDirty = 0;
+        }
+
+        void addDirty(Piece pc, Square from, Square to) {
+            dirtyPieces[numDirty++] = {pc, from, to};
         }
     };
 
@@ -58,6 +82,16 @@ namespace Chess {
 
         explicit Board(const std::string &fen);
 
+        // sets up the position of the fen without allocating, returns false
+        // and keeps the current position if the fen is invalid
+        bool setFen(std::string_view fen);
+        // writes the fen and a null character into out, which needs MAX_FEN_LENGTH
+        // chars, returns the length of the fen
+        int writeFen(char *out) const;
+        // starts the history over at the current position, positions before
+        // it are no longer seen by the repetition detection
+        void resetHistory();
+
         void print(Color c);
 
         std::string fen() const;
@@ -65,11 +99,24 @@ namespace Chess {
         Piece pieceAt(Square s) const { return board[s]; }
         Color sideToMove() const { return stm; }
         int ply() const { return gamePly; }
+        int fullMoveNumber() const { return 1 + (plyOffset + gamePly) / 2; }
         U64 getHash() const { return hash; }
+        // hash of the pawns only, used by the pawn hash table
+        U64 getPawnHash() const { return pawnHash; }
+        U64 keyAfter(const Move &move) const;
         Square kingSquare(Color c) const {return bsf(pieceBitboard(c, KING)); }
 
+        // piece square scores from white's view, kept up to date incrementally
+        int mgScore() const { return psqMg; }
+        int egScore() const { return psqEg; }
+
+        int pieceCount(Piece pc) const { return pieceCounts[pc]; }
+        // hash of the piece counts, used by the material table
+        U64 getMaterialHash() const { return materialHash; }
+
         U64 occupancy(Color c) const;
         U64 isAttacked(Color c, Square s, U64 occ) const;
+        U64 attackMap(Color c, U64 occ) const;
 
         bool inCheck() const;
         bool nonPawnMat(Color c) const;
@@ -92,7 +139,16 @@ namespace Chess {
         Piece board[NUM_SQUARES];
         Color stm;
         int gamePly;
+        // plies played before the start position, given by its fullmove number
+        int plyOffset;
         U64 hash;
+        U64 pawnHash;
+
+        int psqMg;
+        int psqEg;
+
+        U64 materialHash;
+        int pieceCounts[NUM_PIECES];
 
         void putPiece(Piece pc, Square s);
         void removePiece(Square s);
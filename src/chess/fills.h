@@ -0,0 +1,142 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_FILLS_H
+#define ASTRA_FILLS_H
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "bitboard.h"
+
+namespace Chess {
+
+    /*
+     * Setwise Attack Generation
+     *
+     * These functions compute the combined attacks of all pieces in a bitboard at once,
+     * instead of looking up the attacks of every piece on its own. Sliders use Kogge-Stone
+     * occluded fills, which need three shift steps per direction.
+     */
+    constexpr U64 NOT_FILE_A = ~MASK_FILE[FILE_A];
+    constexpr U64 NOT_FILE_H = ~MASK_FILE[FILE_H];
+    constexpr U64 NOT_FILE_AB = ~(MASK_FILE[FILE_A] | MASK_FILE[FILE_B]);
+    constexpr U64 NOT_FILE_GH = ~(MASK_FILE[FILE_G] | MASK_FILE[FILE_H]);
+
+    // squares a shift in the direction can land on without wrapping around the board
+    constexpr U64 wrapMask(Direction d) {
+        return d == EAST || d == NORTH_EAST || d == SOUTH_EAST ? NOT_FILE_A
+        : d == WEST || d == NORTH_WEST || d == SOUTH_WEST ? NOT_FILE_H
+        : ~0ULL;
+    }
+
+    constexpr U64 shiftBy(U64 b, int s) {
+        return s > 0 ? b << s : b >> -s;
+    }
+
+    // all squares the pieces in gen reach in direction d over empty squares, including their own
+    template<Direction D>
+    constexpr U64 occludedFill(U64 gen, U64 empty) {
+        empty &= wrapMask(D);
+        gen |= empty & shiftBy(gen, D);
+        empty &= shiftBy(empty, D);
+        gen |= empty & shiftBy(gen, 2 * D);
+        empty &= shiftBy(empty, 2 * D);
+        gen |= empty & shiftBy(gen, 4 * D);
+        return gen;
+    }
+
+    template<Direction D>
+    constexpr U64 slidingAttacks(U64 sliders, U64 empty) {
+        return shiftBy(occludedFill<D>(sliders, empty), D) & wrapMask(D);
+    }
+
+    constexpr U64 pawnAttacksBB(Color c, U64 pawns) {
+        return c == WHITE
+               ? shift(NORTH_EAST, pawns) | shift(NORTH_WEST, pawns)
+               : shift(SOUTH_EAST, pawns) | shift(SOUTH_WEST, pawns);
+    }
+
+    constexpr U64 knightAttacksBB(U64 knights) {
+        const U64 l1 = (knights >> 1) & NOT_FILE_H;
+        const U64 l2 = (knights >> 2) & NOT_FILE_GH;
+        const U64 r1 = (knights << 1) & NOT_FILE_A;
+        const U64 r2 = (knights << 2) & NOT_FILE_AB;
+        const U64 h1 = l1 | r1;
+        const U64 h2 = l2 | r2;
+        return (h1 << 16) | (h1 >> 16) | (h2 << 8) | (h2 >> 8);
+    }
+
+    constexpr U64 kingAttacksBB(U64 kings) {
+        const U64 row = kings | shift(EAST, kings) | shift(WEST, kings);
+        return (row | shift(NORTH, row) | shift(SOUTH, row)) ^ kings;
+    }
+
+    inline U64 rookAttacksBB(U64 rooks, U64 occ) {
+        const U64 empty = ~occ;
+        return slidingAttacks<NORTH>(rooks, empty) | slidingAttacks<SOUTH>(rooks, empty) |
+               slidingAttacks<EAST>(rooks, empty) | slidingAttacks<WEST>(rooks, empty);
+    }
+
+    inline U64 bishopAttacksBB(U64 bishops, U64 occ) {
+        const U64 empty = ~occ;
+        return slidingAttacks<NORTH_EAST>(bishops, empty) | slidingAttacks<NORTH_WEST>(bishops, empty) |
+               slidingAttacks<SOUTH_EAST>(bishops, empty) | slidingAttacks<SOUTH_WEST>(bishops, empty);
+    }
+
+    // combined attacks of orthogonal and diagonal sliders, with AVX2 one
+    // register holds the fills of four directions, so all eight take two passes
+    inline U64 sliderAttacksBB(U64 orth, U64 diag, U64 occ) {
+#if defined(__AVX2__)
+        const __m256i shifts = _mm256_setr_epi64x(8, 1, 9, 7);
+        const __m256i gen = _mm256_setr_epi64x(orth, orth, diag, diag);
+        const __m256i empty = _mm256_set1_epi64x(~occ);
+
+        // north, east, north east and north west shift left
+        const __m256i leftMask = _mm256_setr_epi64x(~0ULL, NOT_FILE_A, NOT_FILE_A, NOT_FILE_H);
+        // south, west, south west and south east shift right
+        const __m256i rightMask = _mm256_setr_epi64x(~0ULL, NOT_FILE_H, NOT_FILE_H, NOT_FILE_A);
+
+        __m256i l = gen, r = gen;
+        __m256i lEmpty = _mm256_and_si256(empty, leftMask);
+        __m256i rEmpty = _mm256_and_si256(empty, rightMask);
+        __m256i s = shifts;
+
+        for (int i = 0; i < 3; ++i) {
+            l = _mm256_or_si256(l, _mm256_and_si256(lEmpty, _mm256_sllv_epi64(l, s)));
+            r = _mm256_or_si256(r, _mm256_and_si256(rEmpty, _mm256_srlv_epi64(r, s)));
+            lEmpty = _mm256_and_si256(lEmpty, _mm256_sllv_epi64(lEmpty, s));
+            rEmpty = _mm256_and_si256(rEmpty, _mm256_srlv_epi64(rEmpty, s));
+            s = _mm256_add_epi64(s, s);
+        }
+
+        l = _mm256_and_si256(_mm256_sllv_epi64(l, shifts), leftMask);
+        r = _mm256_and_si256(_mm256_srlv_epi64(r, shifts), rightMask);
+
+        const __m256i all = _mm256_or_si256(l, r);
+        const __m128i half = _mm_or_si128(_mm256_castsi256_si128(all), _mm256_extracti128_si256(all, 1));
+        return U64(_mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1));
+#else
+        return rookAttacksBB(orth, occ) | bishopAttacksBB(diag, occ);
+#endif
+    }
+
+} // namespace Chess
+
+#endif //ASTRA_FILLS_H
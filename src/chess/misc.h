@@ -35,11 +35,23 @@ namespace Chess {
         std::cout << std::endl;
     }
 
-    // helper to represent the castleHelper rights in the fen notation
-    inline bool castleNotationHelper(const std::ostringstream &fenStream) {
-        const std::string fen = fenStream.str();
-        const std::string rights = fen.substr(fen.find(' ') + 1);
-        return rights.find_first_of("kqKQ") != std::string::npos;
+    // helper to get the piece of a fen character, NO_PIECE for any other character
+    constexpr Piece fenPiece(char ch) {
+        switch (ch) {
+            case 'P': return WHITE_PAWN;
+            case 'N': return WHITE_KNIGHT;
+            case 'B': return WHITE_BISHOP;
+            case 'R': return WHITE_ROOK;
+            case 'Q': return WHITE_QUEEN;
+            case 'K': return WHITE_KING;
+            case 'p': return BLACK_PAWN;
+            case 'n': return BLACK_KNIGHT;
+            case 'b': return BLACK_BISHOP;
+            case 'r': return BLACK_ROOK;
+            case 'q': return BLACK_QUEEN;
+            case 'k': return BLACK_KING;
+            default: return NO_PIECE;
+        }
     }
 
     // helper to determine the type of the promotion
@@ -68,6 +80,11 @@ namespace Chess {
             os << "NULL MOVE";
         } else {
             os << SQSTR[m.from()] << SQSTR[m.to()];
+
+            // promotions in uci notation, e.g. e7e8q
+            if (m.flags() >= PR_KNIGHT) {
+                os << "pnbrqk"[typeOfPromotion(m.flags())];
+            }
         }
         return os;
     }
@@ -131,6 +148,13 @@ namespace Chess {
         return File(s & 0b111);
     }
 
+    // number of king moves between two squares
+    constexpr int distance(Square a, Square b) {
+        const int files = squareFile(a) > squareFile(b) ? squareFile(a) - squareFile(b) : squareFile(b) - squareFile(a);
+        const int ranks = squareRank(a) > squareRank(b) ? squareRank(a) - squareRank(b) : squareRank(b) - squareRank(a);
+        return files > ranks ? files : ranks;
+    }
+
     // gets the diagonal (a1 to h8) of the square
     constexpr int squareDiag(Square s) {
         return 7 + squareRank(s) - squareFile(s);
@@ -20,8 +20,10 @@
 #define ASTRA_PERFT_H
 
 #include <chrono>
+#include <memory>
 #include "board.h"
 #include "movegen.h"
+#include "../data/packedpos.h"
 
 namespace Chess {
     struct TestCase {
@@ -120,6 +122,94 @@ namespace Chess {
         exit(0);
     }
 
+    void collectFens(Board &board, int depth, std::vector<std::string> &fens) {
+        char fen[MAX_FEN_LENGTH];
+        board.writeFen(fen);
+        fens.emplace_back(fen);
+
+        if (depth == 0) {
+            return;
+        }
+
+        for (Move move: MoveList(board)) {
+            board.makeMove(move);
+            collectFens(board, depth - 1, fens);
+            board.unmakeMove(move);
+        }
+    }
+
+    // checks that fens survive setFen and writeFen unchanged and measures their speed
+    inline void testFen() {
+        std::vector<std::string> fens;
+        for (const auto &testCase: testCases) {
+            Board board(testCase.fen);
+            collectFens(board, 3, fens);
+        }
+
+        Board board(DEFAULT_FEN);
+        char fen[MAX_FEN_LENGTH];
+
+        for (const auto &f: fens) {
+            if (!board.setFen(f) || board.writeFen(fen) != int(f.size()) || f != fen) {
+                std::cerr << "Test failed! Fen: " << f << std::endl;
+                exit(1);
+            }
+        }
+
+        // the packed parser reads the same fens without a board
+        for (const auto &f: fens) {
+            PackedPosition pos;
+            if (!PackedPosition::fromFen(f, pos) || pos.fen() != f) {
+                std::cerr << "Test failed! Packed fen: " << f << std::endl;
+                exit(1);
+            }
+        }
+
+        // malformed fens must be rejected by both parsers and leave the board unchanged
+        const std::string invalidFens[] = {
+            "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq e3 0 1",
+            "rnbqkbnr/pppp1ppp/8/4p3/8/8/PPPPPPPP/RNBQKBNR b KQkq e6 0 1",
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkx - 0 1",
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1",
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1x",
+        };
+
+        board.setFen(DEFAULT_FEN);
+        for (const auto &f: invalidFens) {
+            PackedPosition pos;
+            if (board.setFen(f) || board.writeFen(fen) != int(DEFAULT_FEN.size()) || DEFAULT_FEN != fen ||
+                PackedPosition::fromFen(f, pos)) {
+                std::cerr << "Test failed! Accepted invalid fen: " << f << std::endl;
+                exit(1);
+            }
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const auto &f: fens) {
+            board.setFen(f);
+        }
+        // writeFen cycles through boards of different fens, a single board would stay in the cache
+        constexpr std::size_t NUM_BOARDS = 256;
+        std::vector<std::unique_ptr<Board>> boards;
+        for (std::size_t i = 0; i < NUM_BOARDS; ++i) {
+            boards.push_back(std::make_unique<Board>(fens[i * fens.size() / NUM_BOARDS]));
+        }
+
+        auto mid = std::chrono::high_resolution_clock::now();
+        for (std::size_t i = 0; i < fens.size(); ++i) {
+            boards[i % NUM_BOARDS]->writeFen(fen);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        std::chrono::duration<double> parseTime = mid - start;
+        std::chrono::duration<double> writeTime = end - mid;
+        std::cout << "Test passed | Fens: " << fens.size()
+                  << " | setFen: " << fens.size() / parseTime.count() / 1e6 << " M/s"
+                  << " | writeFen: " << fens.size() / writeTime.count() / 1e6 << " M/s" << std::endl;
+
+        exit(0);
+    }
+
 } // namespace Chess
 
 #endif //ASTRA_PERFT_H
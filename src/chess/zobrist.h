@@ -47,19 +47,37 @@ namespace Chess {
     };
 
     namespace zobrist {
+        // seed of the zobrist keys, saved tables are only valid for the same keys
+        constexpr U64 SEED = 70026072;
+
         // zobrist keys for each piece and each square
         // used to incrementally update the hash key of a position
         inline U64 zobristTable[NUM_PIECES][NUM_SQUARES];
 
+        // keys of the rest of the position, the hash of the board only covers the pieces,
+        // these complete the keys of training positions
+        inline U64 sideKey;
+        inline U64 castlingKeys[16];
+        inline U64 epKeys[8];
+
         // initializes the zobrist table with random 64-bit numbers
         inline void initZobristKeys() {
-            PRNG rng(70026072);
+            PRNG rng(SEED);
 
             for (auto & i : zobristTable) {
                 for (U64 & j : i) {
                     j = rng.rand<U64>();
                 }
             }
+
+            // drawn after the piece keys, so those stay the same
+            sideKey = rng.rand<U64>();
+            for (U64 & key : castlingKeys) {
+                key = rng.rand<U64>();
+            }
+            for (U64 & key : epKeys) {
+                key = rng.rand<U64>();
+            }
         }
     } // namespace zobrist
 
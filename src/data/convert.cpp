@@ -0,0 +1,205 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include "convert.h"
+#include "dedup.h"
+#include "mappedfile.h"
+#include "pipeline.h"
+
+namespace Chess {
+
+    constexpr std::size_t CHUNK_SIZE = 8 << 20;
+
+    struct Chunk {
+        std::vector<PackedPosition> positions;
+        U64 lines = 0;
+        U64 skipped = 0;
+    };
+
+    static std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '"' || s.front() == '\t')) {
+            s.remove_prefix(1);
+        }
+        while (!s.empty() && (s.back() == ' ' || s.back() == '"' || s.back() == '\t' || s.back() == '\r')) {
+            s.remove_suffix(1);
+        }
+        return s;
+    }
+
+    // parses an eval from white's view and returns it from the view of the side to move
+    static bool parseEval(std::string_view s, Color stm, int &eval) {
+        // mate scores are given as #+n or #-n, n moves of the mating side
+        if (!s.empty() && s.front() == '#') {
+            s.remove_prefix(1);
+            const bool whiteMates = s.empty() || s.front() != '-';
+            if (!s.empty() && (s.front() == '+' || s.front() == '-')) {
+                s.remove_prefix(1);
+            }
+
+            int mateIn = 0;
+            const auto res = std::from_chars(s.data(), s.data() + s.size(), mateIn);
+            if (res.ec != std::errc() || res.ptr != s.data() + s.size() || mateIn < 0) {
+                return false;
+            }
+
+            // the side to move mates after 2n - 1 plies, the other side after 2n plies
+            const bool stmMates = whiteMates == (stm == WHITE);
+            const int plies = mateIn == 0 ? 0 : stmMates ? 2 * mateIn - 1 : 2 * mateIn;
+
+            eval = VALUE_MATE - std::min(plies, MAX_PLY);
+            eval = stmMates ? eval : -eval;
+            return true;
+        }
+
+        // evals can have a sign and decimals, strtod needs a terminated string
+        char buffer[32];
+        if (s.empty() || s.size() >= sizeof(buffer)) {
+            return false;
+        }
+
+        std::memcpy(buffer, s.data(), s.size());
+        buffer[s.size()] = '\0';
+
+        char *end;
+        const double value = std::strtod(buffer, &end);
+        if (end != buffer + s.size()) {
+            return false;
+        }
+
+        eval = int(std::lround(std::clamp(value, -32767.0, 32767.0)));
+        eval = stm == WHITE ? eval : -eval;
+        return true;
+    }
+
+    // returns false if the line is not a position
+    static bool parseLine(std::string_view line, PackedPosition &pos) {
+        const std::size_t comma = line.find(',');
+        if (comma == std::string_view::npos) {
+            return false;
+        }
+
+        int eval;
+        if (!PackedPosition::fromFen(trim(line.substr(0, comma)), pos) ||
+            !parseEval(trim(line.substr(comma + 1)), pos.sideToMove(), eval)) {
+            return false;
+        }
+
+        pos.score = int16_t(eval);
+        pos.result = DRAW;
+        return true;
+    }
+
+    static void parseChunk(const char *begin, const char *end, Chunk &chunk) {
+        chunk.positions.clear();
+        chunk.lines = chunk.skipped = 0;
+
+        while (begin < end) {
+            const char *newline = static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+            const char *lineEnd = newline ? newline : end;
+            const std::string_view line(begin, lineEnd - begin);
+            begin = lineEnd + 1;
+
+            if (trim(line).empty()) {
+                continue;
+            }
+
+            PackedPosition pos;
+            chunk.lines++;
+            if (parseLine(line, pos)) {
+                chunk.positions.push_back(pos);
+            } else {
+                chunk.skipped++;
+            }
+        }
+    }
+
+    bool convertCsv(const std::string &csvPath, const std::string &outPath, int numThreads, ConvertStats &stats,
+                    std::size_t dedupMemory) {
+        const MappedFile file(csvPath);
+        if (!file.isOpen()) {
+            return false;
+        }
+
+        PackedWriter writer(outPath, 1 << 18);
+        if (!writer.isOpen()) {
+            return false;
+        }
+
+        const char *data = file.data();
+        const std::size_t size = file.size();
+
+        // skip the header line
+        const char *newline = static_cast<const char *>(std::memchr(data, '\n', size));
+        const std::size_t start = newline ? newline - data + 1 : size;
+
+        // start of the line which contains the offset
+        const auto lineStart = [&](std::size_t offset) -> std::size_t {
+            if (offset <= start) return start;
+            if (offset >= size) return size;
+
+            const void *nl = std::memchr(data + offset - 1, '\n', size - offset + 1);
+            return nl ? static_cast<const char *>(nl) - data + 1 : size;
+        };
+
+        std::unique_ptr<Deduplicator> dedup;
+        if (dedupMemory > 0) {
+            dedup = std::make_unique<Deduplicator>(dedupMemory);
+        }
+
+        const std::size_t numChunks = (size - start + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        const auto startTime = std::chrono::steady_clock::now();
+
+        runPipeline<Chunk>(numChunks, numThreads, [&](std::size_t i, Chunk &chunk, int) {
+            parseChunk(data + lineStart(start + i * CHUNK_SIZE), data + lineStart(start + (i + 1) * CHUNK_SIZE), chunk);
+        }, [&](std::size_t i, Chunk &chunk) {
+            if (dedup) {
+                const std::size_t parsed = chunk.positions.size();
+                dedup->filter(chunk.positions);
+                stats.duplicates += parsed - chunk.positions.size();
+            }
+
+            writer.write(chunk.positions.data(), chunk.positions.size());
+            stats.lines += chunk.lines;
+            stats.converted += chunk.positions.size();
+            stats.skipped += chunk.skipped;
+
+            const std::size_t begin = lineStart(start + i * CHUNK_SIZE);
+            file.release(begin, lineStart(start + (i + 1) * CHUNK_SIZE) - begin);
+        });
+
+        if (!writer.close()) {
+            return false;
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        std::cout << "Converted " << stats.converted << " of " << stats.lines << " positions, skipped "
+                  << stats.skipped << " in " << seconds << "s ("
+                  << U64(double(size) / (1 << 20) / std::max(seconds, 1e-9)) << " MB/s)" << std::endl;
+
+        if (dedup) {
+            dedup->printStats();
+        }
+
+        return true;
+    }
+
+} // namespace Chess
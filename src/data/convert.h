@@ -0,0 +1,55 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_CONVERT_H
+#define ASTRA_CONVERT_H
+
+#include "packedfile.h"
+
+namespace Chess {
+
+    /*
+     * CSV Conversion
+     *
+     * Converts a csv file with a header line and "fen,eval" lines into a packed position file.
+     * The eval is in centipawns from white's view and is stored from the view of the side to
+     * move, like every packed score. Mate scores like #+3 or #-3 give the moves of the mating
+     * side, white for #+3, and are mapped to mate values with the distance in plies. The
+     * dataset has no game results, so every position is stored as a draw.
+     *
+     * The input is mapped and split into chunks on line boundaries, which are parsed by the
+     * worker threads and written in input order. Only a few chunks are in flight at once, so
+     * the memory use does not depend on the size of the file.
+     *
+     * With a dedup memory above zero, positions seen before are dropped. The duplicates are
+     * removed in input order, so the first occurrence is kept whatever the number of threads.
+     */
+    struct ConvertStats {
+        U64 lines = 0;
+        U64 converted = 0;
+        U64 skipped = 0;
+        U64 duplicates = 0;
+    };
+
+    // returns false if a file could not be opened
+    bool convertCsv(const std::string &csvPath, const std::string &outPath, int numThreads, ConvertStats &stats,
+                    std::size_t dedupMemory = 0);
+
+} // namespace Chess
+
+#endif //ASTRA_CONVERT_H
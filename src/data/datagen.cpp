@@ -0,0 +1,277 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include "datagen.h"
+#include "dedup.h"
+#include "gamerecord.h"
+
+namespace Astra {
+
+    constexpr U64 PROGRESS_INTERVAL = 1000;
+
+    // a played move with the score of the position before it from the view of its side to move
+    struct PlyRecord {
+        Move move;
+        int score;
+    };
+
+    // state shared by all threads
+    struct DatagenShared {
+        const DatagenOptions &options;
+        std::atomic<U64> gamesStarted{0};
+
+        std::mutex mutex;
+        std::unique_ptr<PackedWriter> packedWriter;
+        std::unique_ptr<GameWriter> gameWriter;
+        std::unique_ptr<Deduplicator> dedup;
+
+        U64 games = 0;
+        U64 positions = 0;
+        U64 results[3] = {0, 0, 0};
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+        explicit DatagenShared(const DatagenOptions &options) : options(options) {}
+    };
+
+    // the history of the board only holds MAX_PLY * 2 plies, the searches need room on top of
+    // the game, so long games continue from a reset board. Repetitions before it are lost
+    static void resetLongGame(Board &board) {
+        if (board.ply() >= MAX_PLY) {
+            board.resetHistory();
+        }
+    }
+
+    // plays random moves from the start position, returns false if the game is already over
+    static bool playRandomOpening(Board &board, std::mt19937_64 &rng, int plies) {
+        board.setFen(DEFAULT_FEN);
+
+        for (int i = 0; i < plies; ++i) {
+            MoveList moves(board);
+            if (moves.size() == 0) {
+                return false;
+            }
+
+            board.makeMove(moves[int(rng() % moves.size())]);
+        }
+
+        MoveList moves(board);
+        return moves.size() != 0 && !board.isDraw();
+    }
+
+    static void writeGame(DatagenShared &shared, const Board &start, const std::vector<PlyRecord> &plies,
+                          std::vector<PackedPosition> &positions, int finalScore, GameResult result) {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+
+        if (shared.gameWriter) {
+            Board board = start;
+            shared.gameWriter->beginGame(board, plies.empty() ? finalScore : plies[0].score);
+
+            for (std::size_t i = 0; i < plies.size(); ++i) {
+                resetLongGame(board);
+                if (!shared.gameWriter->addPly(board, plies[i].move, i + 1 < plies.size() ? plies[i + 1].score : finalScore)) {
+                    break;
+                }
+                board.makeMove(plies[i].move);
+            }
+
+            shared.gameWriter->endGame(result);
+            shared.positions += plies.size() + 1;
+
+            // no game is started once the output can't be written
+            if (shared.gameWriter->hasFailed()) {
+                shared.gamesStarted = shared.options.numGames;
+            }
+        } else {
+            for (auto &pos: positions) {
+                pos.result = result;
+            }
+
+            if (shared.dedup) {
+                shared.dedup->filter(positions);
+            }
+
+            shared.packedWriter->write(positions.data(), positions.size());
+            shared.positions += positions.size();
+
+            // no game is started once the output can't be written
+            if (shared.packedWriter->hasFailed()) {
+                shared.gamesStarted = shared.options.numGames;
+            }
+        }
+
+        shared.games++;
+        shared.results[result]++;
+
+        if (shared.games % PROGRESS_INTERVAL == 0 || shared.games == shared.options.numGames) {
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - shared.startTime).count();
+            std::cout << "games " << shared.games
+                      << " positions " << shared.positions
+                      << " positions/s " << U64(shared.positions / std::max(seconds, 1e-9))
+                      << " +" << shared.results[WHITE_WIN] << " =" << shared.results[DRAW] << " -" << shared.results[BLACK_WIN]
+                      << std::endl;
+        }
+    }
+
+    static void playGames(DatagenShared &shared, int threadId) {
+        const DatagenOptions &options = shared.options;
+
+        TTable tt(options.hashSize);
+        Board board(DEFAULT_FEN);
+        Board start(DEFAULT_FEN);
+
+        Search search(board, tt);
+        search.setPrintInfo(false);
+
+        SearchLimits limits;
+        limits.nodes = options.nodes;
+
+        std::mt19937_64 rng(options.seed * 0x9E3779B97F4A7C15ULL + threadId);
+        std::vector<PlyRecord> plies;
+        std::vector<PackedPosition> positions;
+
+        while (shared.gamesStarted++ < options.numGames) {
+            // every game starts with an empty table, so the games do not depend on each other
+            tt.clear(1);
+            search.clear();
+
+            // both sides should get to move first after the opening
+            const int openingPlies = options.randomPlies + int(rng() & 1);
+            while (true) {
+                if (!playRandomOpening(board, rng, openingPlies)) {
+                    continue;
+                }
+
+                search.setBoard(board);
+                search.findBestMove(limits);
+                if (std::abs(search.getScore()) <= options.maxOpeningScore) {
+                    break;
+                }
+            }
+
+            start = board;
+            plies.clear();
+            positions.clear();
+
+            GameResult result = DRAW;
+            int finalScore = 0;
+
+            // plies in a row with a decisive score, positive if white is winning
+            int winCount = 0;
+            int drawCount = 0;
+
+            while (true) {
+                resetLongGame(board);
+
+                const Color stm = board.sideToMove();
+                MoveList moves(board);
+
+                if (moves.size() == 0) {
+                    if (board.inCheck()) {
+                        result = stm == WHITE ? BLACK_WIN : WHITE_WIN;
+                        finalScore = -VALUE_MATE;
+                    }
+                    break;
+                }
+
+                if (board.isDraw() || int(plies.size()) >= options.maxPlies) {
+                    break;
+                }
+
+                search.setBoard(board);
+                Move move = search.findBestMove(limits);
+                const int score = search.getScore();
+                const int whiteScore = stm == WHITE ? score : -score;
+
+                // Adjudication
+                if (whiteScore >= options.winScore) {
+                    winCount = std::max(winCount, 0) + 1;
+                } else if (whiteScore <= -options.winScore) {
+                    winCount = std::min(winCount, 0) - 1;
+                } else {
+                    winCount = 0;
+                }
+
+                const bool drawish = int(plies.size()) >= options.drawMinPly && std::abs(score) <= options.drawScore;
+                drawCount = drawish ? drawCount + 1 : 0;
+
+                if (std::abs(winCount) >= options.winPlies || drawCount >= options.drawPlies) {
+                    result = winCount > 0 ? WHITE_WIN : winCount < 0 ? BLACK_WIN : DRAW;
+                    finalScore = score;
+                    break;
+                }
+
+                if (!options.gameRecords && !board.inCheck() && !isCapture(move) && !isPromotion(move)) {
+                    positions.push_back(PackedPosition::fromBoard(board, score));
+                }
+
+                plies.push_back({move, score});
+                board.makeMove(move);
+            }
+
+            writeGame(shared, start, plies, positions, finalScore, result);
+        }
+    }
+
+    bool generateData(const DatagenOptions &options) {
+        DatagenShared shared(options);
+
+        if (options.gameRecords) {
+            shared.gameWriter = std::make_unique<GameWriter>(options.outPath);
+            if (!shared.gameWriter->isOpen()) {
+                return false;
+            }
+        } else {
+            shared.packedWriter = std::make_unique<PackedWriter>(options.outPath, 1 << 16);
+            if (!shared.packedWriter->isOpen()) {
+                return false;
+            }
+
+            if (options.dedupMemory > 0) {
+                shared.dedup = std::make_unique<Deduplicator>(options.dedupMemory);
+            }
+        }
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < std::max(options.numThreads, 1); ++t) {
+            threads.emplace_back(playGames, std::ref(shared), t);
+        }
+
+        for (std::thread &thread: threads) {
+            thread.join();
+        }
+
+        if (shared.gameWriter ? !shared.gameWriter->close() : !shared.packedWriter->close()) {
+            return false;
+        }
+
+        std::cout << "Saved " << shared.positions << " positions of " << shared.games
+                  << " games at " << options.outPath << std::endl;
+
+        if (shared.dedup) {
+            shared.dedup->printStats();
+        }
+
+        return true;
+    }
+
+} // namespace Astra
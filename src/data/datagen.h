@@ -0,0 +1,71 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_DATAGEN_H
+#define ASTRA_DATAGEN_H
+
+#include "../search/search.h"
+
+namespace Astra {
+
+    /*
+     * Self-Play Data Generation
+     *
+     * Every thread plays its own games with its own search and transposition table, the
+     * threads only share the output file. A game starts with a few random plies and every
+     * move is searched with a node limit. Once the score stays decisive or close to zero
+     * for a few plies, the game is adjudicated.
+     *
+     * Packed output keeps the quiet positions only, so positions in check or with a capture
+     * or promotion as best move are skipped. Game records keep every position of a game.
+     * Packed positions seen before can be dropped, game records are never deduplicated.
+     */
+    struct DatagenOptions {
+        std::string outPath = "datagen.bin";
+        // write game records instead of packed positions
+        bool gameRecords = false;
+
+        int numThreads = 1;
+        U64 numGames = 100;
+        // hash size of every thread in MB
+        int hashSize = 16;
+        U64 nodes = 5000;
+        U64 seed = 1;
+        // memory of the duplicate filter of packed output in MB, 0 keeps duplicates
+        std::size_t dedupMemory = 0;
+
+        // the opening plies are random, the opening is played again if its score is too high
+        int randomPlies = 8;
+        int maxOpeningScore = 1000;
+
+        // a game is won once the score stays beyond winScore for winPlies plies
+        int winScore = 2500;
+        int winPlies = 6;
+        // a game is drawn once the score stays within drawScore for drawPlies plies after drawMinPly
+        int drawScore = 8;
+        int drawPlies = 12;
+        int drawMinPly = 80;
+        int maxPlies = 600;
+    };
+
+    // returns false if the output could not be written
+    bool generateData(const DatagenOptions &options);
+
+} // namespace Astra
+
+#endif //ASTRA_DATAGEN_H
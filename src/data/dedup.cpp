@@ -0,0 +1,158 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "dedup.h"
+
+namespace Chess {
+
+    constexpr int NUM_SHARDS = 64;
+    constexpr std::size_t MIN_SHARD_CAPACITY = 1024;
+
+    // a quarter of the memory goes to the bloom filter, the rest to the exact set. The filter has
+    // about 28 bits for every key the exact set can hold, so it stays selective once the set is full
+    Deduplicator::Deduplicator(std::size_t memoryMB) : shards(NUM_SHARDS) {
+        const std::size_t bytes = std::max<std::size_t>(memoryMB, 1) << 20;
+
+        bloom.resize(std::max<std::size_t>(bytes / 4 / sizeof(BloomBlock), 1));
+
+        // the capacity of a shard is a power of two
+        const std::size_t slots = bytes / 4 * 3 / sizeof(U64) / NUM_SHARDS;
+        maxShardCapacity = MIN_SHARD_CAPACITY;
+        while (maxShardCapacity * 2 <= slots) {
+            maxShardCapacity *= 2;
+        }
+
+        for (Shard &shard: shards) {
+            shard.keys.resize(MIN_SHARD_CAPACITY, 0);
+        }
+    }
+
+    bool Deduplicator::testAndSetBloom(U64 key) {
+        BloomBlock &block = bloom[(key >> 32) * bloom.size() >> 32];
+
+        // one bit in every word of the block, taken from a remix of the key
+        U64 bits = key * 0x9E3779B97F4A7C15ULL;
+        bool seen = true;
+
+        for (U64 &word: block.words) {
+            const U64 bit = 1ULL << (bits & 63);
+            seen &= (word & bit) != 0;
+            word |= bit;
+            bits >>= 6;
+        }
+
+        return seen;
+    }
+
+    bool Deduplicator::shardContains(const Shard &shard, U64 key) {
+        const std::size_t mask = shard.keys.size() - 1;
+
+        for (std::size_t i = key & mask; shard.keys[i] != 0; i = (i + 1) & mask) {
+            if (shard.keys[i] == key) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool Deduplicator::shardInsert(Shard &shard, U64 key) {
+        // the shards are kept at most three quarters full
+        if ((shard.size + 1) * 4 > shard.keys.size() * 3) {
+            if (shard.keys.size() >= maxShardCapacity) {
+                return false;
+            }
+
+            std::vector<U64> keys(shard.keys.size() * 2, 0);
+            const std::size_t mask = keys.size() - 1;
+
+            for (const U64 k: shard.keys) {
+                if (k == 0) {
+                    continue;
+                }
+
+                std::size_t i = k & mask;
+                while (keys[i] != 0) {
+                    i = (i + 1) & mask;
+                }
+                keys[i] = k;
+            }
+
+            shard.keys.swap(keys);
+        }
+
+        const std::size_t mask = shard.keys.size() - 1;
+        std::size_t i = key & mask;
+        while (shard.keys[i] != 0) {
+            i = (i + 1) & mask;
+        }
+
+        shard.keys[i] = key;
+        shard.size++;
+        return true;
+    }
+
+    bool Deduplicator::insert(U64 key) {
+        dedupStats.positions++;
+
+        if (key == 0) {
+            const bool seen = zeroSeen;
+            zeroSeen = true;
+            seen ? dedupStats.duplicates++ : dedupStats.unique++;
+            return !seen;
+        }
+
+        const bool maybeSeen = testAndSetBloom(key);
+        Shard &shard = shards[key >> 58];
+
+        if (maybeSeen && shardContains(shard, key)) {
+            dedupStats.duplicates++;
+            return false;
+        }
+
+        // once the shard is full only the bloom filter remembers the key
+        if (!shardInsert(shard, key) && maybeSeen) {
+            dedupStats.probableDuplicates++;
+            return false;
+        }
+
+        dedupStats.unique++;
+        return true;
+    }
+
+    void Deduplicator::filter(std::vector<PackedPosition> &positions) {
+        std::size_t kept = 0;
+        for (const PackedPosition &pos: positions) {
+            if (insert(pos)) {
+                positions[kept++] = pos;
+            }
+        }
+
+        positions.resize(kept);
+    }
+
+    void Deduplicator::printStats() const {
+        const DedupStats &s = dedupStats;
+        const U64 dropped = s.duplicates + s.probableDuplicates;
+
+        std::cout << "Dropped " << dropped << " of " << s.positions << " positions as duplicates ("
+                  << (s.positions ? 100.0 * dropped / s.positions : 0) << "%), "
+                  << s.probableDuplicates << " of them only by the bloom filter" << std::endl;
+    }
+
+} // namespace Chess
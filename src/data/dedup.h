@@ -0,0 +1,94 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_DEDUP_H
+#define ASTRA_DEDUP_H
+
+#include <vector>
+#include "packedpos.h"
+
+namespace Chess {
+
+    struct DedupStats {
+        U64 positions = 0;
+        U64 unique = 0;
+        // duplicates found in the exact set
+        U64 duplicates = 0;
+        // keys the bloom filter has seen once the exact set was full, a few of them are false positives
+        U64 probableDuplicates = 0;
+    };
+
+    /*
+     * Position Deduplication
+     *
+     * Drops positions whose zobrist key was seen before. Every key is tested against a blocked
+     * bloom filter first, each key sets 8 bits in one 64 byte block, so a test touches one cache
+     * line. Only keys the filter may have seen are looked up in the exact set.
+     *
+     * The exact set is split into shards which grow on their own, so a growing shard never
+     * holds more than a small part of the set twice. Memory is bounded by the given size, once
+     * a shard is full the bloom filter alone decides for the keys of that shard.
+     */
+    class Deduplicator {
+    public:
+        explicit Deduplicator(std::size_t memoryMB);
+
+        // returns true if the key was not seen before
+        bool insert(U64 key);
+
+        bool insert(const PackedPosition &pos) {
+            return insert(pos.key());
+        }
+
+        // removes the duplicates from the positions, keeps the order of the others
+        void filter(std::vector<PackedPosition> &positions);
+
+        const DedupStats &stats() const { return dedupStats; }
+
+        void printStats() const;
+
+    private:
+        struct alignas(64) BloomBlock {
+            U64 words[8];
+        };
+
+        struct Shard {
+            std::vector<U64> keys;
+            std::size_t size = 0;
+        };
+
+        std::vector<BloomBlock> bloom;
+
+        std::vector<Shard> shards;
+        std::size_t maxShardCapacity;
+        // 0 marks empty slots of the shards
+        bool zeroSeen = false;
+
+        DedupStats dedupStats;
+
+        // sets the bits of the key, returns true if all of them were set already
+        bool testAndSetBloom(U64 key);
+
+        static bool shardContains(const Shard &shard, U64 key);
+        // returns false if the shard is full
+        bool shardInsert(Shard &shard, U64 key);
+    };
+
+} // namespace Chess
+
+#endif //ASTRA_DEDUP_H
@@ -0,0 +1,124 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "features.h"
+#include "pipeline.h"
+#include "../eval/nnue.h"
+
+namespace Chess {
+
+    constexpr std::size_t FEATURE_CHUNK_SIZE = 1 << 14;
+
+    struct FeatureChunk {
+        std::vector<FeatureRecord> records;
+        U64 skipped = 0;
+    };
+
+    // returns false if the position has no features, see NNUE::collectFeatures
+    static bool toFeatureRecord(const PackedPosition &pos, FeatureRecord &record) {
+        NNUE::PositionFeatures features;
+        if (!NNUE::collectFeatures(pos, features)) {
+            return false;
+        }
+
+        const Color stm = pos.sideToMove();
+
+        record = FeatureRecord{};
+        std::fill(&record.indices[0][0], &record.indices[0][0] + 2 * MAX_FEATURES, NO_FEATURE);
+        std::copy(features.indices[stm], features.indices[stm] + features.count, record.indices[0]);
+        std::copy(features.indices[~stm], features.indices[~stm] + features.count, record.indices[1]);
+
+        record.count = uint8_t(features.count);
+        record.stm = stm;
+        record.score = pos.score;
+        record.result = pos.result;
+        return true;
+    }
+
+    bool exportFeatures(const std::string &inPath, const std::string &outPath, int numThreads) {
+        const MappedFile file(inPath);
+
+        U64 count;
+        const PackedPosition *positions = mappedPositions(file, inPath, count);
+        if (!positions) {
+            return false;
+        }
+
+        std::FILE *out = std::fopen(outPath.c_str(), "wb");
+        if (!out) {
+            std::cerr << "Error: could not open " << outPath << " for writing" << std::endl;
+            return false;
+        }
+
+        FeatureFileHeader header{};
+        std::memcpy(header.magic, FEATURE_FILE_MAGIC, sizeof(header.magic));
+        header.version = FEATURE_FILE_VERSION;
+        header.recordSize = sizeof(FeatureRecord);
+        header.inputSize = NNUE::INPUT_SIZE;
+        header.maxFeatures = MAX_FEATURES;
+
+        bool failed = std::fwrite(&header, sizeof(header), 1, out) != 1;
+
+        const std::size_t numChunks = (count + FEATURE_CHUNK_SIZE - 1) / FEATURE_CHUNK_SIZE;
+        const auto startTime = std::chrono::steady_clock::now();
+
+        U64 exported = 0, skipped = 0;
+
+        runPipeline<FeatureChunk>(numChunks, numThreads, [&](std::size_t i, FeatureChunk &chunk, int) {
+            const std::size_t start = i * FEATURE_CHUNK_SIZE;
+            const std::size_t size = std::min<std::size_t>(FEATURE_CHUNK_SIZE, count - start);
+
+            chunk.records.resize(size);
+            chunk.skipped = 0;
+
+            std::size_t n = 0;
+            for (std::size_t j = 0; j < size; ++j) {
+                if (toFeatureRecord(positions[start + j], chunk.records[n])) {
+                    n++;
+                } else {
+                    chunk.skipped++;
+                }
+            }
+            chunk.records.resize(n);
+        }, [&](std::size_t i, FeatureChunk &chunk) {
+            failed |= std::fwrite(chunk.records.data(), sizeof(FeatureRecord), chunk.records.size(), out) != chunk.records.size();
+            exported += chunk.records.size();
+            skipped += chunk.skipped;
+
+            file.release(sizeof(PackedFileHeader) + i * FEATURE_CHUNK_SIZE * sizeof(PackedPosition),
+                         FEATURE_CHUNK_SIZE * sizeof(PackedPosition));
+        });
+
+        failed |= std::fclose(out) != 0;
+        if (failed) {
+            std::cerr << "Error: could not write " << outPath << std::endl;
+            return false;
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        std::cout << "Exported the features of " << exported << " positions, skipped " << skipped
+                  << " invalid in " << seconds << "s ("
+                  << U64(count / std::max(seconds, 1e-9)) << " positions/s)" << std::endl;
+
+        return true;
+    }
+
+} // namespace Chess
@@ -0,0 +1,73 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_FEATURES_H
+#define ASTRA_FEATURES_H
+
+#include "packedfile.h"
+
+namespace Chess {
+
+    constexpr int MAX_FEATURES = 32;
+    // index of the unused slots of a record
+    constexpr uint16_t NO_FEATURE = 0xffff;
+
+    /*
+     * Feature File
+     *
+     * The active input features of every position of a packed file, with the feature mapping
+     * of the network (see NNUE::featureIndex). The file starts with a FeatureFileHeader and
+     * holds one FeatureRecord per position, so a trainer can map it and index the records.
+     * Invalid positions, e.g. without exactly one king per side, are skipped.
+     *
+     * indices[0] holds the features from the view of the side to move, indices[1] those from
+     * the view of the other side. The first count slots of both are used, the rest hold
+     * NO_FEATURE. The score is from the view of the side to move, the result from white's.
+     */
+    struct FeatureFileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t recordSize;
+        // number of features of a perspective
+        uint32_t inputSize;
+        uint32_t maxFeatures;
+        uint8_t reserved[12];
+    };
+
+    static_assert(sizeof(FeatureFileHeader) == 32, "the file header must be 32 bytes");
+
+    struct FeatureRecord {
+        uint16_t indices[2][MAX_FEATURES];
+        uint8_t count;
+        uint8_t stm;
+        int16_t score;
+        uint8_t result;
+        uint8_t reserved[3];
+    };
+
+    static_assert(sizeof(FeatureRecord) == 136, "feature records must be 136 bytes");
+
+    constexpr char FEATURE_FILE_MAGIC[4] = {'A', 'F', 'T', 'R'};
+    constexpr uint32_t FEATURE_FILE_VERSION = 1;
+
+    // returns false if a file could not be opened
+    bool exportFeatures(const std::string &inPath, const std::string &outPath, int numThreads);
+
+} // namespace Chess
+
+#endif //ASTRA_FEATURES_H
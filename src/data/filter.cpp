@@ -0,0 +1,147 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+#include "filter.h"
+#include "packedfile.h"
+#include "pipeline.h"
+
+namespace Astra {
+
+    constexpr std::size_t FILTER_CHUNK_SIZE = 4096;
+
+    struct FilterChunk {
+        std::vector<PackedPosition> positions;
+        FilterStats stats;
+    };
+
+    // the search and table of a worker thread
+    struct FilterWorker {
+        TTable tt;
+        Board board;
+        Search search;
+
+        explicit FilterWorker(int hashSize) : tt(hashSize), board(DEFAULT_FEN), search(board, tt) {
+            search.setPrintInfo(false);
+        }
+    };
+
+    static void filterChunk(const PackedPosition *positions, std::size_t count, const FilterOptions &options,
+                            FilterWorker &worker, FilterChunk &chunk) {
+        Search &search = worker.search;
+        chunk.positions.clear();
+        chunk.stats = FilterStats();
+
+        worker.tt.clear(1);
+        search.clear();
+
+        SearchLimits limits;
+        limits.depth = options.rescoreDepth;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            PackedPosition pos = positions[i];
+            chunk.stats.positions++;
+
+            // the records are mapped from the file, a corrupt one must not reach fen() or the search
+            if (!pos.isValid() || !search.setFen(pos.fen())) {
+                chunk.stats.invalid++;
+                continue;
+            }
+
+            Board &board = search.getBoard();
+            if (board.inCheck()) {
+                chunk.stats.inCheck++;
+                continue;
+            }
+
+            // positions without a legal move can't be searched and are no training positions
+            if (MoveList(board).size() == 0) {
+                chunk.stats.invalid++;
+                continue;
+            }
+
+            if (search.quiescence() > search.staticEval() + options.quietMargin) {
+                chunk.stats.noisy++;
+                continue;
+            }
+
+            if (options.rescoreDepth > 0) {
+                search.findBestMove(limits);
+                pos.score = int16_t(std::clamp(search.getScore(), -32767, 32767));
+            }
+
+            chunk.positions.push_back(pos);
+            chunk.stats.kept++;
+        }
+    }
+
+    bool filterPositions(const std::string &inPath, const std::string &outPath,
+                         const FilterOptions &options, FilterStats &stats) {
+        const MappedFile file(inPath);
+
+        U64 count;
+        const PackedPosition *positions = mappedPositions(file, inPath, count);
+        if (!positions) {
+            return false;
+        }
+
+        PackedWriter writer(outPath, 1 << 16);
+        if (!writer.isOpen()) {
+            return false;
+        }
+
+        const int numThreads = std::max(options.numThreads, 1);
+        std::vector<std::unique_ptr<FilterWorker>> workers;
+        for (int t = 0; t < numThreads; ++t) {
+            workers.push_back(std::make_unique<FilterWorker>(options.hashSize));
+        }
+
+        const std::size_t numChunks = (count + FILTER_CHUNK_SIZE - 1) / FILTER_CHUNK_SIZE;
+        const auto startTime = std::chrono::steady_clock::now();
+
+        runPipeline<FilterChunk>(numChunks, numThreads, [&](std::size_t i, FilterChunk &chunk, int thread) {
+            const std::size_t start = i * FILTER_CHUNK_SIZE;
+            filterChunk(positions + start, std::min<std::size_t>(FILTER_CHUNK_SIZE, count - start),
+                        options, *workers[thread], chunk);
+        }, [&](std::size_t i, FilterChunk &chunk) {
+            writer.write(chunk.positions.data(), chunk.positions.size());
+
+            stats.positions += chunk.stats.positions;
+            stats.inCheck += chunk.stats.inCheck;
+            stats.noisy += chunk.stats.noisy;
+            stats.invalid += chunk.stats.invalid;
+            stats.kept += chunk.stats.kept;
+
+            file.release(sizeof(PackedFileHeader) + i * FILTER_CHUNK_SIZE * sizeof(PackedPosition),
+                         FILTER_CHUNK_SIZE * sizeof(PackedPosition));
+        });
+
+        if (!writer.close()) {
+            return false;
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        std::cout << "Kept " << stats.kept << " of " << stats.positions << " positions, "
+                  << stats.inCheck << " in check, " << stats.noisy << " not quiet, " << stats.invalid
+                  << " invalid in " << seconds << "s ("
+                  << U64(stats.positions / std::max(seconds, 1e-9)) << " positions/s)" << std::endl;
+
+        return true;
+    }
+
+} // namespace Astra
@@ -0,0 +1,61 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_FILTER_H
+#define ASTRA_FILTER_H
+
+#include "../search/search.h"
+
+namespace Astra {
+
+    /*
+     * Quiet Position Filter
+     *
+     * Reads a packed position file and keeps the quiet positions only. A position is quiet
+     * if the side to move is not in check, has a legal move and the quiescence search can't
+     * improve on the static evaluation by more than the margin. The kept positions can be
+     * scored again with a fixed depth search.
+     *
+     * Every thread has its own search and table. Both are cleared at the start of every
+     * chunk, so the output does not depend on the number of threads.
+     */
+    struct FilterOptions {
+        int numThreads = 1;
+        // hash size of every thread in MB
+        int hashSize = 4;
+        int quietMargin = 0;
+        // depth of the search the kept positions are scored with, 0 keeps their scores
+        int rescoreDepth = 0;
+    };
+
+    struct FilterStats {
+        U64 positions = 0;
+        U64 inCheck = 0;
+        U64 noisy = 0;
+        // corrupt records and positions without a legal move
+        U64 invalid = 0;
+        U64 kept = 0;
+    };
+
+    // returns false if a file could not be opened
+    bool filterPositions(const std::string &inPath, const std::string &outPath,
+                         const FilterOptions &options, FilterStats &stats);
+
+} // namespace Astra
+
+#endif //ASTRA_FILTER_H
@@ -0,0 +1,312 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include "gamerecord.h"
+
+namespace Chess {
+
+    constexpr std::size_t IO_BLOCK_SIZE = 1 << 20;
+
+    // the scores of the records are 16 bit, the encoder works on the stored values
+    static int clampScore(int score) {
+        return std::clamp(score, -32767, 32767);
+    }
+
+    static void writeVarint(std::vector<uint8_t> &out, U64 value) {
+        while (value >= 0x80) {
+            out.push_back(uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(uint8_t(value));
+    }
+
+    // maps signed values to unsigned ones, so small negative values stay small
+    static U64 zigzag(int64_t value) {
+        return U64(value) << 1 ^ U64(value >> 63);
+    }
+
+    static int64_t unzigzag(U64 value) {
+        return int64_t(value >> 1) ^ -int64_t(value & 1);
+    }
+
+    static bool readHeader(std::FILE *file) {
+        PackedFileHeader header{};
+        return std::fread(&header, sizeof(header), 1, file) == 1 &&
+               std::memcmp(header.magic, GAME_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+               header.version == GAME_FILE_VERSION &&
+               header.recordSize == sizeof(PackedPosition);
+    }
+
+    /*
+     * Game Writer
+     */
+    GameWriter::GameWriter(const std::string &path) :
+            file(std::fopen(path.c_str(), "wb")), start{}, numPlies(0), lastScore(0),
+            games(0), positions(0), bytes(0), failed(false) {
+        if (!file) {
+            failed = true;
+            std::cerr << "Error: could not open " << path << " for writing" << std::endl;
+            return;
+        }
+
+        PackedFileHeader header{};
+        std::memcpy(header.magic, GAME_FILE_MAGIC, sizeof(header.magic));
+        header.version = GAME_FILE_VERSION;
+        header.recordSize = sizeof(PackedPosition);
+
+        if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+            setFailed();
+        }
+        bytes += sizeof(header);
+        buffer.reserve(IO_BLOCK_SIZE * 2);
+    }
+
+    GameWriter::~GameWriter() {
+        close();
+    }
+
+    void GameWriter::setFailed() {
+        if (!failed) {
+            std::cerr << "Error: could not write games" << std::endl;
+        }
+        failed = true;
+    }
+
+    void GameWriter::beginGame(const Board &board, int score) {
+        score = clampScore(score);
+        start = PackedPosition::fromBoard(board, score);
+        lastScore = board.sideToMove() == WHITE ? score : -score;
+
+        plies.clear();
+        numPlies = 0;
+    }
+
+    bool GameWriter::addPly(Board &board, Move move, int score) {
+        if (failed) {
+            return false;
+        }
+
+        if (U64(numPlies) >= MAX_GAME_PLIES) {
+            std::cerr << "Error: games are limited to " << MAX_GAME_PLIES << " plies" << std::endl;
+            failed = true;
+            return false;
+        }
+
+        MoveList moves(board);
+
+        int index = 0;
+        while (index < int(moves.size()) && moves[index] != move) {
+            index++;
+        }
+
+        if (index == int(moves.size())) {
+            std::cerr << "Error: " << move << " is not legal in " << board.fen() << std::endl;
+            failed = true;
+            return false;
+        }
+
+        // the score belongs to the position after the move, so to the other side
+        score = clampScore(score);
+        const int whiteScore = board.sideToMove() == WHITE ? -score : score;
+
+        plies.push_back(uint8_t(index));
+        writeVarint(plies, zigzag(whiteScore - lastScore));
+
+        lastScore = whiteScore;
+        numPlies++;
+        return true;
+    }
+
+    void GameWriter::endGame(GameResult result) {
+        if (failed) {
+            return;
+        }
+
+        start.result = result;
+
+        const auto *startBytes = reinterpret_cast<const uint8_t *>(&start);
+        buffer.insert(buffer.end(), startBytes, startBytes + sizeof(PackedPosition));
+        writeVarint(buffer, numPlies);
+        buffer.insert(buffer.end(), plies.begin(), plies.end());
+
+        games++;
+        positions += numPlies + 1;
+
+        if (buffer.size() >= IO_BLOCK_SIZE) {
+            flush();
+        }
+    }
+
+    void GameWriter::flush() {
+        if (!file || buffer.empty()) {
+            return;
+        }
+
+        const std::size_t n = std::fwrite(buffer.data(), 1, buffer.size(), file);
+        if (n != buffer.size()) {
+            setFailed();
+        }
+
+        bytes += n;
+        buffer.clear();
+    }
+
+    bool GameWriter::close() {
+        if (!file) {
+            return !failed;
+        }
+
+        flush();
+        if (std::fclose(file) != 0) {
+            setFailed();
+        }
+        file = nullptr;
+        return !failed;
+    }
+
+    /*
+     * Game Reader
+     */
+    GameReader::GameReader(const std::string &path) : file(std::fopen(path.c_str(), "rb")), pos(0), end(0) {
+        if (!file) {
+            std::cerr << "Error: could not open " << path << std::endl;
+            return;
+        }
+
+        if (!readHeader(file)) {
+            std::cerr << "Error: " << path << " is not a game record file of version "
+                      << GAME_FILE_VERSION << std::endl;
+            std::fclose(file);
+            file = nullptr;
+            return;
+        }
+
+        buffer.resize(IO_BLOCK_SIZE);
+    }
+
+    GameReader::~GameReader() {
+        if (file) {
+            std::fclose(file);
+        }
+    }
+
+    // makes sure that at least count bytes are buffered
+    bool GameReader::fill(std::size_t count) {
+        if (end - pos >= count) {
+            return true;
+        }
+        if (!file) {
+            return false;
+        }
+
+        std::memmove(buffer.data(), buffer.data() + pos, end - pos);
+        end -= pos;
+        pos = 0;
+        end += std::fread(buffer.data() + end, 1, buffer.size() - end, file);
+
+        return end - pos >= count;
+    }
+
+    bool GameReader::readVarint(U64 &value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!fill(1)) {
+                return false;
+            }
+
+            const uint8_t byte = buffer[pos++];
+            value |= U64(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool GameReader::nextGame(std::vector<PackedPosition> &positions) {
+        positions.clear();
+
+        PackedPosition start{};
+        U64 numPlies;
+        if (!fill(sizeof(PackedPosition))) {
+            return false;
+        }
+
+        std::memcpy(&start, buffer.data() + pos, sizeof(PackedPosition));
+        pos += sizeof(PackedPosition);
+        if (!readVarint(numPlies)) {
+            std::cerr << "Error: truncated game record" << std::endl;
+            return false;
+        }
+
+        // the count and the start position come from the file, they are checked before they are used
+        if (numPlies > MAX_GAME_PLIES || !start.isValid() || start.result > WHITE_WIN) {
+            std::cerr << "Error: corrupt game record" << std::endl;
+            return false;
+        }
+
+        Board board(DEFAULT_FEN);
+        if (!board.setFen(start.fen())) {
+            std::cerr << "Error: corrupt game record" << std::endl;
+            return false;
+        }
+
+        const auto result = GameResult(start.result);
+        int whiteScore = start.sideToMove() == WHITE ? start.score : -start.score;
+
+        positions.reserve(numPlies + 1);
+        positions.push_back(start);
+
+        for (U64 i = 1; i <= numPlies; ++i) {
+            U64 delta;
+            if (!fill(1)) {
+                std::cerr << "Error: truncated game record" << std::endl;
+                return false;
+            }
+
+            const int index = buffer[pos++];
+            if (!readVarint(delta)) {
+                std::cerr << "Error: truncated game record" << std::endl;
+                return false;
+            }
+
+            MoveList moves(board);
+            if (index >= int(moves.size())) {
+                std::cerr << "Error: invalid move index in game record" << std::endl;
+                return false;
+            }
+
+            // the board only keeps MAX_PLY * 2 plies of history, long games continue from a reset board
+            if (board.ply() >= MAX_PLY * 2 - 1) {
+                board.resetHistory();
+            }
+
+            board.makeMove(moves[index]);
+
+            whiteScore += int(unzigzag(delta));
+            const int score = board.sideToMove() == WHITE ? whiteScore : -whiteScore;
+
+            positions.push_back(PackedPosition::fromBoard(board, score, result));
+        }
+
+        return true;
+    }
+
+} // namespace Chess
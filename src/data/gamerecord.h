@@ -0,0 +1,123 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_GAMERECORD_H
+#define ASTRA_GAMERECORD_H
+
+#include "packedfile.h"
+#include "../chess/movegen.h"
+
+namespace Chess {
+
+    /*
+     * Game Record File
+     *
+     * Stores whole games instead of single positions. After a PackedFileHeader with the magic
+     * "AGAM", every game is stored as:
+     *
+     * PackedPosition: the start position with its score, the result of the game
+     * varint:         number of plies
+     * per ply:        1 byte index of the move in MoveList order of the position before it,
+     *                 zigzag varint of the score change from white's view
+     *
+     * Every ply adds one position, which costs 2-3 bytes instead of 32. The positions are
+     * restored by replaying the moves from the start position.
+     */
+    constexpr char GAME_FILE_MAGIC[4] = {'A', 'G', 'A', 'M'};
+    constexpr uint32_t GAME_FILE_VERSION = 1;
+    // more plies than any legal game can have, longer games in a file are corrupt
+    constexpr U64 MAX_GAME_PLIES = 1 << 15;
+
+    class GameWriter {
+    public:
+        explicit GameWriter(const std::string &path);
+        ~GameWriter();
+
+        GameWriter(const GameWriter &) = delete;
+        GameWriter &operator=(const GameWriter &) = delete;
+
+        bool isOpen() const { return file != nullptr; }
+        // true once a write failed or a game could not be encoded, nothing is written after it
+        bool hasFailed() const { return failed; }
+
+        // starts a new game, the score is from the view of the side to move
+        void beginGame(const Board &board, int score);
+
+        // adds the move played in the position on the board, the score is the score
+        // of the resulting position from the view of its side to move. Returns false if
+        // the move is not legal or the game is too long, the writer has failed then
+        bool addPly(Board &board, Move move, int score);
+
+        // writes the game, the result is from white's view
+        void endGame(GameResult result);
+
+        // returns false if anything could not be written
+        bool close();
+
+        U64 gameCount() const { return games; }
+        U64 positionCount() const { return positions; }
+        U64 bytesWritten() const { return bytes; }
+
+    private:
+        std::FILE *file;
+
+        PackedPosition start;
+        std::vector<uint8_t> plies;
+        int numPlies;
+        int lastScore;
+
+        // games are collected here and written in large blocks
+        std::vector<uint8_t> buffer;
+
+        U64 games;
+        U64 positions;
+        U64 bytes;
+        bool failed;
+
+        void setFailed();
+        void flush();
+    };
+
+    class GameReader {
+    public:
+        explicit GameReader(const std::string &path);
+        ~GameReader();
+
+        GameReader(const GameReader &) = delete;
+        GameReader &operator=(const GameReader &) = delete;
+
+        bool isOpen() const { return file != nullptr; }
+
+        // decodes the next game into positions, returns false at the end of the file or if the
+        // game is corrupt
+        bool nextGame(std::vector<PackedPosition> &positions);
+
+    private:
+        std::FILE *file;
+
+        std::vector<uint8_t> buffer;
+        std::size_t pos;
+        std::size_t end;
+
+        bool fill(std::size_t count);
+        bool readVarint(U64 &value);
+    };
+
+} // namespace Chess
+
+#endif //ASTRA_GAMERECORD_H
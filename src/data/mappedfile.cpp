@@ -0,0 +1,112 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ASTRA_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mappedfile.h"
+
+namespace Chess {
+
+    MappedFile::MappedFile(const std::string &path) : ptr(nullptr), length(0), mapped(false) {
+#ifdef ASTRA_POSIX
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            std::cerr << "Error: could not open " << path << std::endl;
+            return;
+        }
+
+        struct stat st{};
+        void *mem = MAP_FAILED;
+
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            mem = mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+
+        close(fd);
+
+        if (mem == MAP_FAILED) {
+            std::cerr << "Error: could not map " << path << std::endl;
+            return;
+        }
+
+        // the files are mostly read from front to back
+        madvise(mem, std::size_t(st.st_size), MADV_SEQUENTIAL);
+
+        ptr = static_cast<const char *>(mem);
+        length = std::size_t(st.st_size);
+        mapped = true;
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            std::cerr << "Error: could not open " << path << std::endl;
+            return;
+        }
+
+        contents.resize(std::size_t(file.tellg()));
+        file.seekg(0);
+        if (contents.empty() || !file.read(contents.data(), std::streamsize(contents.size()))) {
+            std::cerr << "Error: could not read " << path << std::endl;
+            contents.clear();
+            return;
+        }
+
+        ptr = contents.data();
+        length = contents.size();
+#endif
+    }
+
+    MappedFile::~MappedFile() {
+#ifdef ASTRA_POSIX
+        if (mapped) {
+            munmap(const_cast<char *>(ptr), length);
+        }
+#endif
+    }
+
+    void MappedFile::release(std::size_t offset, std::size_t count) const {
+#ifdef ASTRA_POSIX
+        if (!mapped) {
+            return;
+        }
+
+        // only whole pages of the file can be released, madvise would also drop the pages
+        // of other mappings behind it
+        const auto pageSize = std::size_t(sysconf(_SC_PAGESIZE));
+        const std::size_t begin = (offset + pageSize - 1) / pageSize * pageSize;
+        const std::size_t end = std::min(offset + count, length) / pageSize * pageSize;
+
+        if (begin < end) {
+            madvise(const_cast<char *>(ptr) + begin, end - begin, MADV_DONTNEED);
+        }
+#else
+        (void) offset;
+        (void) count;
+#endif
+    }
+
+} // namespace Chess
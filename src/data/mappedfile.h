@@ -0,0 +1,57 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_MAPPEDFILE_H
+#define ASTRA_MAPPEDFILE_H
+
+#include <string>
+#include <vector>
+
+namespace Chess {
+
+    /*
+     * A read only view of a whole file. On POSIX systems the file is mapped, so pages are
+     * only loaded when they are used and can be dropped again with release. Elsewhere the
+     * file is read into memory.
+     */
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string &path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        bool isOpen() const { return ptr != nullptr; }
+
+        const char *data() const { return ptr; }
+        std::size_t size() const { return length; }
+
+        // tells the os that the range is no longer needed, so its pages can be dropped
+        void release(std::size_t offset, std::size_t count) const;
+
+    private:
+        const char *ptr;
+        std::size_t length;
+        bool mapped;
+        std::vector<char> contents;
+    };
+
+} // namespace Chess
+
+#endif //ASTRA_MAPPEDFILE_H
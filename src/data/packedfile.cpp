@@ -0,0 +1,159 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <filesystem>
+#include "packedfile.h"
+
+namespace Chess {
+
+    bool isValidHeader(const PackedFileHeader &header) {
+        return std::memcmp(header.magic, PACKED_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+               header.version == PACKED_FILE_VERSION &&
+               header.recordSize == sizeof(PackedPosition);
+    }
+
+    const PackedPosition *mappedPositions(const MappedFile &file, const std::string &path, U64 &count) {
+        count = 0;
+        if (!file.isOpen()) {
+            return nullptr;
+        }
+
+        PackedFileHeader header{};
+        if (file.size() < sizeof(header)) {
+            std::cerr << "Error: " << path << " is not a packed position file" << std::endl;
+            return nullptr;
+        }
+
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (!isValidHeader(header)) {
+            std::cerr << "Error: " << path << " is not a packed position file of version "
+                      << PACKED_FILE_VERSION << std::endl;
+            return nullptr;
+        }
+
+        count = (file.size() - sizeof(header)) / sizeof(PackedPosition);
+        return reinterpret_cast<const PackedPosition *>(file.data() + sizeof(header));
+    }
+
+    /*
+     * Packed Writer
+     */
+    PackedWriter::PackedWriter(const std::string &path, std::size_t bufferSize) :
+            file(std::fopen(path.c_str(), "wb")), bufferSize(bufferSize), written(0), failed(false) {
+        if (!file) {
+            failed = true;
+            std::cerr << "Error: could not open " << path << " for writing" << std::endl;
+            return;
+        }
+
+        PackedFileHeader header{};
+        std::memcpy(header.magic, PACKED_FILE_MAGIC, sizeof(header.magic));
+        header.version = PACKED_FILE_VERSION;
+        header.recordSize = sizeof(PackedPosition);
+
+        if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+            setFailed();
+        }
+        buffer.reserve(bufferSize);
+    }
+
+    PackedWriter::~PackedWriter() {
+        close();
+    }
+
+    void PackedWriter::setFailed() {
+        if (!failed) {
+            std::cerr << "Error: could not write positions" << std::endl;
+        }
+        failed = true;
+    }
+
+    void PackedWriter::write(const PackedPosition *positions, std::size_t count) {
+        flush();
+        if (!file) {
+            return;
+        }
+
+        const std::size_t n = std::fwrite(positions, sizeof(PackedPosition), count, file);
+        if (n != count) {
+            setFailed();
+        }
+        written += n;
+    }
+
+    void PackedWriter::flush() {
+        if (!file || buffer.empty()) {
+            return;
+        }
+
+        const std::size_t n = std::fwrite(buffer.data(), sizeof(PackedPosition), buffer.size(), file);
+        if (n != buffer.size()) {
+            setFailed();
+        }
+
+        written += n;
+        buffer.clear();
+    }
+
+    bool PackedWriter::close() {
+        if (!file) {
+            return !failed;
+        }
+
+        flush();
+        if (std::fclose(file) != 0) {
+            setFailed();
+        }
+        file = nullptr;
+        return !failed;
+    }
+
+    /*
+     * Packed Reader
+     */
+    PackedReader::PackedReader(const std::string &path) : file(std::fopen(path.c_str(), "rb")), total(0) {
+        if (!file) {
+            std::cerr << "Error: could not open " << path << std::endl;
+            return;
+        }
+
+        PackedFileHeader header{};
+        if (std::fread(&header, sizeof(header), 1, file) != 1 || !isValidHeader(header)) {
+            std::cerr << "Error: " << path << " is not a packed position file of version "
+                      << PACKED_FILE_VERSION << std::endl;
+            std::fclose(file);
+            file = nullptr;
+            return;
+        }
+
+        // ftell can't handle files above 2 GB on every platform
+        total = (std::filesystem::file_size(path) - sizeof(PackedFileHeader)) / sizeof(PackedPosition);
+    }
+
+    PackedReader::~PackedReader() {
+        if (file) {
+            std::fclose(file);
+        }
+    }
+
+    std::size_t PackedReader::read(PackedPosition *positions, std::size_t maxCount) {
+        return file ? std::fread(positions, sizeof(PackedPosition), maxCount, file) : 0;
+    }
+
+} // namespace Chess
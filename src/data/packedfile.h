@@ -0,0 +1,118 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_PACKEDFILE_H
+#define ASTRA_PACKEDFILE_H
+
+#include <cstdio>
+#include <vector>
+#include "packedpos.h"
+#include "mappedfile.h"
+
+namespace Chess {
+
+    /*
+     * Packed Position File
+     *
+     * A 32 byte header followed by the positions, the number of positions follows
+     * from the file size. Readers have to reject files of another version.
+     */
+    struct PackedFileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t recordSize;
+        uint8_t reserved[20];
+    };
+
+    static_assert(sizeof(PackedFileHeader) == 32, "the file header must be 32 bytes");
+
+    constexpr char PACKED_FILE_MAGIC[4] = {'A', 'P', 'O', 'S'};
+    constexpr uint32_t PACKED_FILE_VERSION = 1;
+
+    // buffers positions and writes them in large blocks
+    class PackedWriter {
+    public:
+        explicit PackedWriter(const std::string &path, std::size_t bufferSize = 1 << 16);
+        ~PackedWriter();
+
+        PackedWriter(const PackedWriter &) = delete;
+        PackedWriter &operator=(const PackedWriter &) = delete;
+
+        bool isOpen() const { return file != nullptr; }
+
+        void write(const PackedPosition &pos) {
+            buffer.push_back(pos);
+            if (buffer.size() == bufferSize) {
+                flush();
+            }
+        }
+
+        void write(const PackedPosition *positions, std::size_t count);
+
+        void flush();
+        // returns false if a write failed, e.g. because the disk is full
+        bool close();
+
+        // true once a write failed, the error sticks until the writer is closed
+        bool hasFailed() const { return failed; }
+
+        // positions written or buffered, positions of failed writes are not counted
+        U64 count() const { return written + buffer.size(); }
+
+    private:
+        std::FILE *file;
+        std::vector<PackedPosition> buffer;
+        std::size_t bufferSize;
+        U64 written;
+        bool failed;
+
+        void setFailed();
+    };
+
+    // reads positions in large blocks
+    class PackedReader {
+    public:
+        explicit PackedReader(const std::string &path);
+        ~PackedReader();
+
+        PackedReader(const PackedReader &) = delete;
+        PackedReader &operator=(const PackedReader &) = delete;
+
+        bool isOpen() const { return file != nullptr; }
+
+        // reads up to maxCount positions, returns the number of positions read, 0 at the end of the file
+        std::size_t read(PackedPosition *positions, std::size_t maxCount);
+
+        // number of positions in the file
+        U64 size() const { return total; }
+
+    private:
+        std::FILE *file;
+        U64 total;
+    };
+
+    // checks the magic, version and record size of a header
+    bool isValidHeader(const PackedFileHeader &header);
+
+    // returns the positions of a mapped packed position file and their number,
+    // or nullptr if it is not a packed position file
+    const PackedPosition *mappedPositions(const MappedFile &file, const std::string &path, U64 &count);
+
+} // namespace Chess
+
+#endif //ASTRA_PACKEDFILE_H
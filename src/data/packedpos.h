@@ -0,0 +1,293 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_PACKEDPOS_H
+#define ASTRA_PACKEDPOS_H
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <string_view>
+#include "../chess/board.h"
+
+namespace Chess {
+
+    // game result from white's view
+    enum GameResult : uint8_t {
+        BLACK_WIN = 0, DRAW = 1, WHITE_WIN = 2
+    };
+
+    // castling rights as stored in a packed position
+    enum PackedCastling : uint8_t {
+        PACKED_WHITE_OO = 1, PACKED_WHITE_OOO = 2, PACKED_BLACK_OO = 4, PACKED_BLACK_OOO = 8
+    };
+
+    /*
+     * Packed Training Position (32 bytes)
+     *
+     * bytes  0-7:  occupancy bitboard
+     * bytes  8-23: 4-bit piece code of every occupied square, in the order of the squares
+     *              from a1 to h8, two codes per byte (low nibble first)
+     * byte  24:    bit 7 side to move, bits 0-6 en passant square (NO_SQUARE if there is none)
+     * byte  25:    castling rights, see PackedCastling
+     * bytes 26-27: score in centipawns from the view of the side to move
+     * byte  28:    game result from white's view, see GameResult
+     * byte  29:    halfmove clock
+     * bytes 30-31: fullmove number
+     *
+     * All values are little endian. Files of packed positions start with a PackedFileHeader.
+     */
+    struct PackedPosition {
+        U64 occupancy;
+        uint8_t pieces[16];
+        uint8_t stmEp;
+        uint8_t castling;
+        int16_t score;
+        uint8_t result;
+        uint8_t halfMoveClock;
+        uint16_t fullMoveNumber;
+
+        // the board must not have more than 32 pieces, further pieces are not stored
+        static PackedPosition fromBoard(const Board &board, int score = 0, GameResult result = DRAW) {
+            PackedPosition pos{};
+
+            int i = 0;
+            for (Square s = a1; s <= h8; ++s) {
+                const Piece pc = board.pieceAt(s);
+                if (pc == NO_PIECE) {
+                    continue;
+                }
+
+                assert(i < 32);
+                if (i == 32) {
+                    break;
+                }
+
+                pos.occupancy |= SQUARE_BB[s];
+                pos.pieces[i / 2] |= pc << (i % 2 * 4);
+                i++;
+            }
+
+            const StateInfo &st = board.history[board.ply()];
+            pos.stmEp = board.sideToMove() << 7 | st.epSquare;
+            pos.castling = (st.castleMask & WHITE_OO_MASK ? 0 : PACKED_WHITE_OO) |
+                           (st.castleMask & WHITE_OOO_MASK ? 0 : PACKED_WHITE_OOO) |
+                           (st.castleMask & BLACK_OO_MASK ? 0 : PACKED_BLACK_OO) |
+                           (st.castleMask & BLACK_OOO_MASK ? 0 : PACKED_BLACK_OOO);
+            pos.score = int16_t(std::clamp(score, -32767, 32767));
+            pos.result = result;
+            pos.halfMoveClock = uint8_t(std::min(st.halfMoveClock, 255));
+            pos.fullMoveNumber = uint16_t(std::min(board.fullMoveNumber(), 65535));
+
+            return pos;
+        }
+
+        // parses a fen straight into a packed position without building a board,
+        // returns false if the fen is malformed. score and result are left at zero
+        static bool fromFen(std::string_view fen, PackedPosition &pos) {
+            pos = PackedPosition{};
+
+            Piece board[NUM_SQUARES];
+
+            // piece placement from a8 to h1, every rank has to add up to eight files
+            std::size_t i = 0;
+            int rank = RANK_8, file = FILE_A, kings[NUM_COLORS] = {0, 0};
+            for (; i < fen.size() && fen[i] != ' '; ++i) {
+                const char ch = fen[i];
+                if (ch == '/') {
+                    if (file != 8 || rank == RANK_1) return false;
+                    rank--;
+                    file = FILE_A;
+                } else if (ch >= '1' && ch <= '8') {
+                    if (file + ch - '0' > 8) return false;
+                    file += ch - '0';
+                } else {
+                    const Piece pc = fenPiece(ch);
+                    if (pc == NO_PIECE || file == 8) return false;
+                    if (typeOfPiece(pc) == KING) kings[colorOfPiece(pc)]++;
+
+                    const int sq = rank * 8 + file++;
+                    pos.occupancy |= SQUARE_BB[sq];
+                    board[sq] = pc;
+                }
+            }
+
+            // a packed position has room for 32 pieces
+            if (rank != RANK_1 || file != 8 || kings[WHITE] != 1 || kings[BLACK] != 1 || popCount(pos.occupancy) > 32) {
+                return false;
+            }
+
+            // the remaining fields, missing ones keep their defaults
+            std::string_view fields[5];
+            for (auto &field: fields) {
+                while (i < fen.size() && fen[i] == ' ') i++;
+                const std::size_t begin = i;
+                while (i < fen.size() && fen[i] != ' ') i++;
+                field = fen.substr(begin, i - begin);
+            }
+
+            if (fields[0] != "w" && fields[0] != "b") {
+                return false;
+            }
+
+            // the same checks as Board::setFen, so both accept the same fens
+            if (fields[1] != "-") {
+                for (const char ch: fields[1]) {
+                    const uint8_t right = ch == 'K' ? PACKED_WHITE_OO
+                                          : ch == 'Q' ? PACKED_WHITE_OOO
+                                          : ch == 'k' ? PACKED_BLACK_OO
+                                          : ch == 'q' ? PACKED_BLACK_OOO : 0;
+                    if (!right) return false;
+                    pos.castling |= right;
+                }
+            }
+
+            Square ep = NO_SQUARE;
+            if (!fields[2].empty() && fields[2] != "-") {
+                const std::string_view epField = fields[2];
+                if (epField.size() != 2 || epField[0] < 'a' || epField[0] > 'h' ||
+                    epField[1] != (fields[0] == "w" ? '6' : '3')) {
+                    return false;
+                }
+                ep = Square((epField[1] - '1') * 8 + epField[0] - 'a');
+            }
+
+            const auto parseNumber = [](std::string_view field, int &value) {
+                if (field.empty()) return true;
+                const auto res = std::from_chars(field.data(), field.data() + field.size(), value);
+                return res.ec == std::errc() && res.ptr == field.data() + field.size() && value >= 0;
+            };
+
+            int halfMoves = 0, fullMoves = 1;
+            if (!parseNumber(fields[3], halfMoves) || !parseNumber(fields[4], fullMoves)) {
+                return false;
+            }
+
+            U64 occ = pos.occupancy;
+            for (int n = 0; occ; ++n) {
+                pos.pieces[n / 2] |= board[popLsb(occ)] << (n % 2 * 4);
+            }
+
+            pos.stmEp = (fields[0] == "b") << 7 | ep;
+            pos.halfMoveClock = uint8_t(std::clamp(halfMoves, 0, 255));
+            pos.fullMoveNumber = uint16_t(std::clamp(fullMoves, 1, 65535));
+            return true;
+        }
+
+        // checks a record which was read from a file before it is decoded. fen() and key() index
+        // tables with the piece codes, and more than 32 occupied squares run past the pieces
+        bool isValid() const {
+            if (popCount(occupancy) > 32) {
+                return false;
+            }
+
+            int kings[NUM_COLORS] = {0, 0};
+            U64 occ = occupancy;
+            for (int i = 0; occ; ++i) {
+                popLsb(occ);
+                const Piece pc = piece(i);
+                if (pc > BLACK_KING) {
+                    return false;
+                }
+                if (typeOfPiece(pc) == KING) {
+                    kings[colorOfPiece(pc)]++;
+                }
+            }
+
+            const Square ep = epSquare();
+            const Rank epRank = sideToMove() == WHITE ? RANK_6 : RANK_3;
+            return kings[WHITE] == 1 && kings[BLACK] == 1 && castling <= 0xf &&
+                   (ep == NO_SQUARE || (ep < NUM_SQUARES && squareRank(ep) == epRank));
+        }
+
+        // piece of the i-th occupied square
+        Piece piece(int i) const {
+            return Piece(pieces[i / 2] >> (i % 2 * 4) & 0xf);
+        }
+
+        Color sideToMove() const {
+            return Color(stmEp >> 7);
+        }
+
+        Square epSquare() const {
+            return Square(stmEp & 0x7f);
+        }
+
+        // zobrist key of the whole position, unlike the hash of the board it includes the side
+        // to move, castling rights and en passant square. Score, result and clocks are ignored
+        U64 key() const {
+            U64 key = sideToMove() == BLACK ? zobrist::sideKey : 0;
+            key ^= zobrist::castlingKeys[castling & 0xf];
+            if (epSquare() != NO_SQUARE) {
+                key ^= zobrist::epKeys[epSquare() & 7];
+            }
+
+            U64 occ = occupancy;
+            for (int i = 0; occ; ++i) {
+                key ^= zobrist::zobristTable[piece(i)][popLsb(occ)];
+            }
+
+            return key;
+        }
+
+        std::string fen() const {
+            Piece board[NUM_SQUARES];
+            std::fill(board, board + NUM_SQUARES, NO_PIECE);
+
+            U64 occ = occupancy;
+            for (int i = 0; occ; ++i) {
+                board[popLsb(occ)] = piece(i);
+            }
+
+            std::ostringstream fen;
+            for (int r = RANK_8; r >= RANK_1; --r) {
+                int empty = 0;
+                for (int f = FILE_A; f <= FILE_H; ++f) {
+                    const Piece pc = board[r * 8 + f];
+                    if (pc == NO_PIECE) {
+                        empty++;
+                        continue;
+                    }
+
+                    if (empty) fen << empty;
+                    fen << PIECE_STR[pc];
+                    empty = 0;
+                }
+
+                if (empty) fen << empty;
+                if (r > RANK_1) fen << '/';
+            }
+
+            fen << (sideToMove() == WHITE ? " w " : " b ");
+            if (!castling) fen << '-';
+            if (castling & PACKED_WHITE_OO) fen << 'K';
+            if (castling & PACKED_WHITE_OOO) fen << 'Q';
+            if (castling & PACKED_BLACK_OO) fen << 'k';
+            if (castling & PACKED_BLACK_OOO) fen << 'q';
+
+            fen << ' ' << (epSquare() == NO_SQUARE ? "-" : SQSTR[epSquare()])
+                << ' ' << int(halfMoveClock) << ' ' << fullMoveNumber;
+            return fen.str();
+        }
+    };
+
+    static_assert(sizeof(PackedPosition) == 32, "packed positions must be 32 bytes");
+
+} // namespace Chess
+
+#endif //ASTRA_PACKEDPOS_H
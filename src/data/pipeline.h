@@ -0,0 +1,95 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_PIPELINE_H
+#define ASTRA_PIPELINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Chess {
+
+    /*
+     * Ordered Pipeline
+     *
+     * Calls process(chunk, slot, thread) for every chunk on numThreads worker threads and
+     * write(chunk, slot) for every chunk in order on the calling thread. There are only two
+     * slots per thread, a worker waits until the slot of its chunk was written, so the memory
+     * use does not depend on the number of chunks.
+     */
+    template<typename Slot, typename Process, typename Write>
+    void runPipeline(std::size_t numChunks, int numThreads, Process process, Write write) {
+        numThreads = std::max(numThreads, 1);
+        const std::size_t numSlots = std::size_t(numThreads) * 2;
+
+        std::vector<Slot> slots(numSlots);
+        std::vector<char> ready(numSlots, false);
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::atomic<std::size_t> nextChunk{0};
+        std::size_t nextWrite = 0;
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < numThreads; ++t) {
+            threads.emplace_back([&, t]() {
+                for (std::size_t i = nextChunk++; i < numChunks; i = nextChunk++) {
+                    // wait until the slot of the chunk has been written
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        cv.wait(lock, [&]() { return i < nextWrite + numSlots; });
+                    }
+
+                    process(i, slots[i % numSlots], t);
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        ready[i % numSlots] = true;
+                    }
+                    cv.notify_all();
+                }
+            });
+        }
+
+        for (std::size_t i = 0; i < numChunks; ++i) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]() { return ready[i % numSlots]; });
+            }
+
+            write(i, slots[i % numSlots]);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready[i % numSlots] = false;
+                nextWrite++;
+            }
+            cv.notify_all();
+        }
+
+        for (std::thread &thread: threads) {
+            thread.join();
+        }
+    }
+
+} // namespace Chess
+
+#endif //ASTRA_PIPELINE_H
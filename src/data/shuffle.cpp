@@ -0,0 +1,207 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include "shuffle.h"
+#include "pipeline.h"
+
+namespace Chess {
+
+    constexpr std::size_t SHUFFLE_CHUNK_SIZE = 1 << 16;
+    // every shard has an open file during the first pass
+    constexpr U64 MAX_SHARDS = 512;
+    // threads of the second pass, each of them holds two shards
+    constexpr int MAX_SHUFFLE_THREADS = 4;
+
+    // the positions of a chunk grouped by their shard
+    struct ShardedChunk {
+        std::vector<PackedPosition> positions;
+        std::vector<uint16_t> shardOf;
+        std::vector<std::size_t> offsets;
+    };
+
+    struct ShardSlot {
+        std::vector<PackedPosition> positions;
+    };
+
+    static std::string shardPath(const std::string &outPath, U64 shard) {
+        return outPath + ".shard" + std::to_string(shard);
+    }
+
+    // every chunk and shard gets its own generator, so the shuffle does not depend on the threads
+    static std::mt19937_64 shuffleRng(U64 seed, U64 stream, U64 index) {
+        return std::mt19937_64(seed * 0x9E3779B97F4A7C15ULL ^ (stream << 56) ^ index);
+    }
+
+    static void scatterChunk(const PackedPosition *positions, std::size_t count, U64 numShards,
+                             std::mt19937_64 rng, ShardedChunk &chunk) {
+        chunk.shardOf.resize(count);
+        chunk.offsets.assign(numShards + 1, 0);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto shard = uint16_t(rng() % numShards);
+            chunk.shardOf[i] = shard;
+            chunk.offsets[shard + 1]++;
+        }
+
+        for (U64 s = 0; s < numShards; ++s) {
+            chunk.offsets[s + 1] += chunk.offsets[s];
+        }
+
+        // counting sort by shard, keeps the input order within a shard
+        chunk.positions.resize(count);
+        std::vector<std::size_t> next(chunk.offsets.begin(), chunk.offsets.end() - 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            chunk.positions[next[chunk.shardOf[i]]++] = positions[i];
+        }
+    }
+
+    bool shufflePositions(const std::string &inPath, const std::string &outPath, const ShuffleOptions &options) {
+        const MappedFile file(inPath);
+
+        U64 count;
+        const PackedPosition *positions = mappedPositions(file, inPath, count);
+        if (!positions) {
+            return false;
+        }
+
+        const int numThreads = std::max(options.numThreads, 1);
+        const U64 memory = std::max<U64>(options.memory, 1) << 20;
+
+        // a shard takes about an eighth of the memory, the second pass holds two shards for each
+        // of its threads. The shards only depend on the memory, so the threads don't change them
+        const U64 inputBytes = count * sizeof(PackedPosition);
+        const U64 numShards = std::clamp<U64>((inputBytes + memory / 8 - 1) / std::max<U64>(memory / 8, 1),
+                                              1, MAX_SHARDS);
+
+        // with the maximum number of shards they get larger, fewer threads keep them within the memory
+        const U64 shardBytes = (inputBytes + numShards - 1) / numShards;
+        const int shuffleThreads = int(std::min<U64>(std::min(numThreads, MAX_SHUFFLE_THREADS),
+                                                     memory / std::max<U64>(2 * shardBytes, 1)));
+        if (shuffleThreads < 1) {
+            std::cerr << "Error: the shards of " << inPath << " need at least " << ((2 * shardBytes) >> 20) + 1
+                      << " MB, use a larger --memory" << std::endl;
+            return false;
+        }
+
+        // the buffers of the shard files get a quarter of the memory
+        const std::size_t bufferSize = std::clamp<std::size_t>(memory / 4 / numShards / sizeof(PackedPosition),
+                                                               1 << 11, 1 << 17);
+
+        const auto startTime = std::chrono::steady_clock::now();
+
+        /*
+         * First pass: scatter the positions to the shards
+         */
+        std::vector<std::unique_ptr<PackedWriter>> shardWriters;
+
+        // the shards are only temporary, they are removed if the shuffle fails
+        const auto removeShards = [&]() {
+            shardWriters.clear();
+            for (U64 s = 0; s < numShards; ++s) {
+                std::remove(shardPath(outPath, s).c_str());
+            }
+        };
+
+        for (U64 s = 0; s < numShards; ++s) {
+            shardWriters.push_back(std::make_unique<PackedWriter>(shardPath(outPath, s), bufferSize));
+            if (!shardWriters.back()->isOpen()) {
+                removeShards();
+                return false;
+            }
+        }
+
+        const std::size_t numChunks = (count + SHUFFLE_CHUNK_SIZE - 1) / SHUFFLE_CHUNK_SIZE;
+
+        runPipeline<ShardedChunk>(numChunks, numThreads, [&](std::size_t i, ShardedChunk &chunk, int) {
+            const std::size_t start = i * SHUFFLE_CHUNK_SIZE;
+            scatterChunk(positions + start, std::min<std::size_t>(SHUFFLE_CHUNK_SIZE, count - start),
+                         numShards, shuffleRng(options.seed, 0, i), chunk);
+        }, [&](std::size_t i, ShardedChunk &chunk) {
+            for (U64 s = 0; s < numShards; ++s) {
+                for (std::size_t j = chunk.offsets[s]; j < chunk.offsets[s + 1]; ++j) {
+                    shardWriters[s]->write(chunk.positions[j]);
+                }
+            }
+
+            file.release(sizeof(PackedFileHeader) + i * SHUFFLE_CHUNK_SIZE * sizeof(PackedPosition),
+                         SHUFFLE_CHUNK_SIZE * sizeof(PackedPosition));
+        });
+
+        bool shardsWritten = true;
+        for (auto &shardWriter: shardWriters) {
+            shardsWritten &= shardWriter->close();
+        }
+
+        if (!shardsWritten) {
+            removeShards();
+            return false;
+        }
+        shardWriters.clear();
+
+        /*
+         * Second pass: shuffle every shard in memory and append it to the output
+         */
+        PackedWriter writer(outPath, 1 << 16);
+        if (!writer.isOpen()) {
+            removeShards();
+            return false;
+        }
+
+        std::atomic<bool> failed{false};
+
+        runPipeline<ShardSlot>(numShards, shuffleThreads, [&](std::size_t s, ShardSlot &slot, int) {
+            PackedReader reader(shardPath(outPath, s));
+            slot.positions.resize(reader.isOpen() ? reader.size() : 0);
+
+            if (reader.read(slot.positions.data(), slot.positions.size()) != slot.positions.size()) {
+                slot.positions.clear();
+                failed = true;
+            }
+
+            std::mt19937_64 rng = shuffleRng(options.seed, 1, s);
+            std::shuffle(slot.positions.begin(), slot.positions.end(), rng);
+        }, [&](std::size_t s, ShardSlot &slot) {
+            writer.write(slot.positions.data(), slot.positions.size());
+            std::remove(shardPath(outPath, s).c_str());
+
+            // the memory of the shard is not needed until the slot is used again
+            std::vector<PackedPosition>().swap(slot.positions);
+        });
+
+        if (!writer.close()) {
+            return false;
+        }
+
+        if (failed || writer.count() != count) {
+            std::cerr << "Error: could not read all shards, " << outPath << " is incomplete" << std::endl;
+            return false;
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        std::cout << "Shuffled " << count << " positions with " << numShards << " shards in " << seconds << "s ("
+                  << U64(count / std::max(seconds, 1e-9)) << " positions/s)" << std::endl;
+
+        return true;
+    }
+
+} // namespace Chess
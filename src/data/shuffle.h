@@ -0,0 +1,52 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_SHUFFLE_H
+#define ASTRA_SHUFFLE_H
+
+#include "packedfile.h"
+
+namespace Chess {
+
+    /*
+     * External Memory Shuffle
+     *
+     * Shuffles a packed position file which does not fit into memory in two passes. The first
+     * pass sends every position to a random shard file, the second pass shuffles the shards in
+     * memory one by one and appends them to the output. Sending every position to a uniformly
+     * random shard and shuffling the shards uniformly gives a uniform shuffle of the file.
+     *
+     * Both passes run on the chunk pipeline, so the output only depends on the seed and not on
+     * the number of threads. A shard file is deleted once it is written to the output, so the
+     * shards and the output take about the size of the input on disk.
+     */
+    struct ShuffleOptions {
+        int numThreads = 1;
+        // memory of the shards in flight in MB, it decides the number of shards. Inputs above 64
+        // times the memory need larger shards, the second pass then runs on fewer threads or fails
+        // if two shards don't fit into the memory
+        std::size_t memory = 1024;
+        U64 seed = 1;
+    };
+
+    // returns false if a file could not be opened
+    bool shufflePositions(const std::string &inPath, const std::string &outPath, const ShuffleOptions &options);
+
+} // namespace Chess
+
+#endif //ASTRA_SHUFFLE_H
@@ -0,0 +1,84 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_EVALCACHE_H
+#define ASTRA_EVALCACHE_H
+
+#include <memory>
+#include "../chess/types.h"
+
+namespace Eval {
+
+    using namespace Chess;
+
+    struct EvalCacheEntry {
+        U64 key;
+        int16_t eval;
+        // the hash does not include the side to move, so it is stored separately
+        uint8_t stm;
+    };
+
+    /*
+     * A small direct mapped cache of static evaluations, owned by one search thread.
+     * It sits in front of the evaluator, so a position whose eval is no longer in the
+     * transposition table is still not evaluated twice.
+     */
+    class EvalCache {
+    public:
+        EvalCache() : entries(new EvalCacheEntry[SIZE]), probes(0), hits(0) {
+            clear();
+        }
+
+        bool probe(U64 hash, Color stm, int &eval) {
+            const EvalCacheEntry &entry = entries[hash & (SIZE - 1)];
+
+            probes++;
+            if (entry.key != hash || entry.stm != stm) {
+                return false;
+            }
+
+            hits++;
+            eval = entry.eval;
+            return true;
+        }
+
+        void store(U64 hash, Color stm, int eval) {
+            entries[hash & (SIZE - 1)] = {hash, int16_t(eval), uint8_t(stm)};
+        }
+
+        void clear() {
+            for (int i = 0; i < SIZE; ++i) {
+                entries[i] = {0, 0, NUM_COLORS};
+            }
+        }
+
+        U64 probeCount() const { return probes; }
+        U64 hitCount() const { return hits; }
+
+    private:
+        static constexpr int SIZE = 16384;
+
+        std::unique_ptr<EvalCacheEntry[]> entries;
+
+        U64 probes;
+        U64 hits;
+    };
+
+} // namespace Eval
+
+#endif //ASTRA_EVALCACHE_H
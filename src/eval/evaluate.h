@@ -19,10 +19,74 @@
 #ifndef ASTRA_CHESS_ENGINE_PESTO_H
 #define ASTRA_CHESS_ENGINE_PESTO_H
 
+#include <algorithm>
+#include "nnue.h"
+#include "pawns.h"
+#include "material.h"
+
 namespace Eval {
 
-   inline int getEval(Board& board) {
-      return 0;
+   constexpr int MOBILITY_MG = 2;
+   constexpr int MOBILITY_EG = 3;
+   constexpr int KING_PRESSURE_MG = 6;
+
+   // mobility of the pieces and pressure on the enemy king zone from the view of the given color,
+   // the attacks of each piece type are computed setwise, so squares are counted once per type
+   inline void evaluateActivity(const Board& board, Color c, int& mg, int& eg) {
+      const U64 occ = board.occupancy(WHITE) | board.occupancy(BLACK);
+      const U64 area = ~board.occupancy(c) & ~pawnAttacksBB(~c, board.pieceBitboard(~c, PAWN));
+
+      const U64 knightAttacks = knightAttacksBB(board.pieceBitboard(c, KNIGHT));
+      const U64 sliderAttacks = sliderAttacksBB(board.orthSliders(c), board.diagSliders(c), occ);
+      const int mobility = popCount(knightAttacks & area) + popCount(sliderAttacks & area);
+
+      const U64 attacks = knightAttacks | sliderAttacks | pawnAttacksBB(c, board.pieceBitboard(c, PAWN));
+      const U64 kingZone = kingAttacksBB(board.pieceBitboard(~c, KING));
+
+      mg += MOBILITY_MG * mobility + KING_PRESSURE_MG * popCount(attacks & kingZone);
+      eg += MOBILITY_EG * mobility;
+   }
+
+   // tapered PeSTO evaluation from the view of the side to move, the piece square scores
+   // are maintained by the board, the pawn structure and the material terms are cached
+   inline int getEval(Board& board, PawnTable& pawnTable, MaterialTable& materialTable) {
+      const MaterialEntry& material = materialTable.probe(board);
+      const Color stm = board.sideToMove();
+
+      if (material.evaluator) {
+         const int score = material.evaluator(board, material.strongSide);
+         return stm == material.strongSide ? score : -score;
+      }
+
+      const PawnEntry& pawns = pawnTable.probe(board);
+      int mg = board.mgScore() + pawns.mg + pawns.shelter + material.imbalance;
+      int eg = board.egScore() + pawns.eg + pawns.passerKings + material.imbalance;
+
+      int activity[NUM_COLORS][2] = {};
+      evaluateActivity(board, WHITE, activity[WHITE][0], activity[WHITE][1]);
+      evaluateActivity(board, BLACK, activity[BLACK][0], activity[BLACK][1]);
+      mg += activity[WHITE][0] - activity[BLACK][0];
+      eg += activity[WHITE][1] - activity[BLACK][1];
+
+      int scale = material.scale[eg > 0 ? WHITE : BLACK];
+      if (material.bishopsOnly && oppositeBishops(board)) {
+         scale = std::min(scale, SCALE_OPPOSITE_BISHOPS);
+      }
+      eg = eg * scale / SCALE_NORMAL;
+
+      const int score = (mg * material.phase + eg * (MAX_PHASE - material.phase)) / MAX_PHASE;
+      return stm == WHITE ? score : -score;
+   }
+
+   // evaluates the position from the view of the side to move,
+   // the network is used whenever one is loaded
+   inline int evaluate(Board& board, NNUE::Accumulators& accumulators, PawnTable& pawnTable,
+                       MaterialTable& materialTable) {
+      if (NNUE::isLoaded()) {
+         return accumulators.evaluate(board);
+      }
+
+      return getEval(board, pawnTable, materialTable);
    }
 
 } // namespace Eval
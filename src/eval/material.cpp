@@ -0,0 +1,179 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include "material.h"
+
+namespace Eval {
+
+    /*
+     * Material Weights
+     */
+    constexpr int BISHOP_PAIR = 30;
+    // knights gain and rooks lose value with every own pawn above five
+    constexpr int KNIGHT_PAWN_ADJUST = 4;
+    constexpr int ROOK_PAWN_ADJUST = 8;
+
+    // added to the score of won endgames, so they are preferred over any normal position
+    constexpr int KNOWN_WIN = 10000;
+
+    constexpr Square DARK_CORNERS[2] = {a1, h8};
+    constexpr Square LIGHT_CORNERS[2] = {a8, h1};
+
+    // bonus for the weak king being close to the edge of the board
+    static int pushToEdge(Square s) {
+        const int f = squareFile(s), r = squareRank(s);
+        return 20 * (std::max(3 - f, f - 4) + std::max(3 - r, r - 4));
+    }
+
+    // bonus for the strong king being close to the weak king
+    static int pushClose(Square a, Square b) {
+        return 20 * (7 - distance(a, b));
+    }
+
+    static int nonPawnMaterial(const Board &board, Color c) {
+        int npm = 0;
+        for (int pt = KNIGHT; pt <= QUEEN; ++pt) {
+            npm += board.pieceCount(makePiece(c, PieceType(pt))) * MG_VALUE[pt];
+        }
+        return npm;
+    }
+
+    // king and enough material to force mate against a lone king
+    static int evaluateKXK(const Board &board, Color strongSide) {
+        const Square strongKing = board.kingSquare(strongSide);
+        const Square weakKing = board.kingSquare(~strongSide);
+
+        int score = KNOWN_WIN + pushToEdge(weakKing) + pushClose(strongKing, weakKing);
+        for (int pt = PAWN; pt <= QUEEN; ++pt) {
+            score += board.pieceCount(makePiece(strongSide, PieceType(pt))) * EG_VALUE[pt];
+        }
+        return score;
+    }
+
+    // two or more bishops against a lone king only mate if they are on squares of both colors,
+    // which the material key does not tell
+    static int evaluateKBBK(const Board &board, Color strongSide) {
+        const U64 bishops = board.pieceBitboard(strongSide, BISHOP);
+        if (!(bishops & DARK_SQUARES) || !(bishops & ~DARK_SQUARES)) {
+            return 0;
+        }
+
+        return evaluateKXK(board, strongSide);
+    }
+
+    // king, bishop and knight against a lone king, the weak king has to be
+    // driven into a corner of the color of the bishop
+    static int evaluateKBNK(const Board &board, Color strongSide) {
+        const Square strongKing = board.kingSquare(strongSide);
+        const Square weakKing = board.kingSquare(~strongSide);
+        const Square bishop = bsf(board.pieceBitboard(strongSide, BISHOP));
+
+        const bool darkBishop = (squareFile(bishop) + squareRank(bishop)) % 2 == 0;
+        const Square *corners = darkBishop ? DARK_CORNERS : LIGHT_CORNERS;
+        const int cornerDistance = std::min(distance(weakKing, corners[0]),
+                                            distance(weakKing, corners[1]));
+
+        return KNOWN_WIN + EG_VALUE[BISHOP] + EG_VALUE[KNIGHT] +
+               40 * (7 - cornerDistance) + pushClose(strongKing, weakKing);
+    }
+
+    MaterialTable::MaterialTable() : entries(new MaterialEntry[SIZE]), probes(0), hits(0) {
+        clear();
+    }
+
+    void MaterialTable::clear() {
+        for (int i = 0; i < SIZE; ++i) {
+            // an empty key never matches, the kings are always part of the material key
+            entries[i] = MaterialEntry();
+        }
+    }
+
+    const MaterialEntry &MaterialTable::probe(const Board &board) {
+        const U64 key = board.getMaterialHash();
+        MaterialEntry &entry = entries[key & (SIZE - 1)];
+
+        probes++;
+        if (entry.key == key) {
+            hits++;
+            return entry;
+        }
+
+        int count[NUM_PIECES];
+        for (int pc = WHITE_PAWN; pc <= BLACK_KING; ++pc) {
+            count[pc] = board.pieceCount(Piece(pc));
+        }
+
+        entry = MaterialEntry();
+        entry.key = key;
+        entry.scale[WHITE] = entry.scale[BLACK] = SCALE_NORMAL;
+        entry.strongSide = WHITE;
+
+        int phase = 0;
+        for (int pc = WHITE_PAWN; pc <= BLACK_KING; ++pc) {
+            phase += count[pc] * PHASE_INC[typeOfPiece(Piece(pc))];
+        }
+        entry.phase = int16_t(std::min(phase, MAX_PHASE));
+
+        int imbalance[NUM_COLORS] = {0, 0};
+        for (Color c: {WHITE, BLACK}) {
+            const int pawns = count[makePiece(c, PAWN)];
+            const int knights = count[makePiece(c, KNIGHT)];
+            const int bishops = count[makePiece(c, BISHOP)];
+            const int rooks = count[makePiece(c, ROOK)];
+            const int queens = count[makePiece(c, QUEEN)];
+
+            if (bishops >= 2) {
+                imbalance[c] += BISHOP_PAIR;
+            }
+            imbalance[c] += knights * (pawns - 5) * KNIGHT_PAWN_ADJUST;
+            imbalance[c] -= rooks * (pawns - 5) * ROOK_PAWN_ADJUST;
+
+            // without pawns, a small material advantage is usually not enough to win
+            const int npm = nonPawnMaterial(board, c);
+            const int theirNpm = nonPawnMaterial(board, ~c);
+            if (!pawns && npm - theirNpm <= MG_VALUE[BISHOP]) {
+                entry.scale[c] = npm < MG_VALUE[ROOK] ? 0 : theirNpm <= MG_VALUE[BISHOP] ? 4 : 14;
+            }
+
+            // recognize endgames against a lone king
+            const bool loneKing = !nonPawnMaterial(board, ~c) && !count[makePiece(~c, PAWN)];
+            if (loneKing && !pawns && !rooks && !queens && knights == 1 && bishops == 1) {
+                entry.evaluator = &evaluateKBNK;
+                entry.strongSide = c;
+            } else if (loneKing && (queens || rooks)) {
+                entry.evaluator = &evaluateKXK;
+                entry.strongSide = c;
+            } else if (loneKing && !pawns && !knights && bishops >= 2) {
+                entry.evaluator = &evaluateKBBK;
+                entry.strongSide = c;
+            }
+        }
+        entry.imbalance = int16_t(imbalance[WHITE] - imbalance[BLACK]);
+
+        entry.bishopsOnly = count[WHITE_BISHOP] == 1 && count[BLACK_BISHOP] == 1;
+        for (int pt = KNIGHT; pt <= QUEEN; ++pt) {
+            if (pt != BISHOP && (count[makePiece(WHITE, PieceType(pt))] || count[makePiece(BLACK, PieceType(pt))])) {
+                entry.bishopsOnly = false;
+            }
+        }
+
+        return entry;
+    }
+
+} // namespace Eval
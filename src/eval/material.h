@@ -0,0 +1,89 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_MATERIAL_H
+#define ASTRA_MATERIAL_H
+
+#include <memory>
+#include "../chess/board.h"
+
+namespace Eval {
+
+    using namespace Chess;
+
+    // endgame scores are scaled by scale / SCALE_NORMAL
+    constexpr int SCALE_NORMAL = 64;
+    constexpr int SCALE_OPPOSITE_BISHOPS = 32;
+
+    // evaluates a known endgame, the score is from the view of the strong side
+    using EndgameFn = int (*)(const Board &board, Color strongSide);
+
+    struct MaterialEntry {
+        U64 key;
+        int16_t phase;
+        // bonus for the piece combination from white's view
+        int16_t imbalance;
+        // endgame scale used when the color is ahead
+        uint8_t scale[NUM_COLORS];
+        // both sides have a single bishop and only pawns besides it,
+        // which is drawish if the bishops are of opposite colors
+        bool bishopsOnly;
+        // specialized evaluator of the endgame, nullptr if there is none
+        EndgameFn evaluator;
+        Color strongSide;
+    };
+
+    /*
+     * Material Hash Table
+     *
+     * Everything that only depends on the piece counts is cached by the material key of the board,
+     * which changes only with captures and promotions. Every search thread owns its own table.
+     */
+    class MaterialTable {
+    public:
+        MaterialTable();
+
+        // returns the entry of the current material, it is computed if it is not cached
+        const MaterialEntry &probe(const Board &board);
+
+        void clear();
+
+        U64 probeCount() const { return probes; }
+        U64 hitCount() const { return hits; }
+
+    private:
+        static constexpr int SIZE = 4096;
+
+        std::unique_ptr<MaterialEntry[]> entries;
+
+        U64 probes;
+        U64 hits;
+    };
+
+    constexpr U64 DARK_SQUARES = 0xAA55AA55AA55AA55ULL;
+
+    // returns true if both sides have a bishop and they are on squares of different colors
+    inline bool oppositeBishops(const Board &board) {
+        const U64 white = board.pieceBitboard(WHITE, BISHOP);
+        const U64 black = board.pieceBitboard(BLACK, BISHOP);
+        return white && black && !(white & DARK_SQUARES) != !(black & DARK_SQUARES);
+    }
+
+} // namespace Eval
+
+#endif //ASTRA_MATERIAL_H
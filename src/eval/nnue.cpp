@@ -0,0 +1,618 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ASTRA_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "nnue.h"
+
+/*
+ * Embedded Network
+ *
+ * If EVALFILE is defined at build time, the network file is included into the read only data of
+ * the binary with the assembler's .incbin directive, aligned to 64 bytes. Since the file layout is
+ * the in-memory layout, the weights are used in place and never copied.
+ */
+#if defined(EVALFILE) && (defined(__GNUC__) || defined(__clang__))
+#define ASTRA_EMBEDDED_NET
+
+#if defined(__APPLE__)
+#define ASTRA_NET_SECTION ".const_data"
+#define ASTRA_NET_SYMBOL(name) "_" #name
+#elif defined(_WIN32)
+#define ASTRA_NET_SECTION ".section .rdata"
+#define ASTRA_NET_SYMBOL(name) #name
+#else
+#define ASTRA_NET_SECTION ".section .rodata"
+#define ASTRA_NET_SYMBOL(name) #name
+#endif
+
+__asm__(ASTRA_NET_SECTION "\n"
+        ".balign 64\n"
+        ".globl " ASTRA_NET_SYMBOL(gEmbeddedNetData) "\n"
+        ASTRA_NET_SYMBOL(gEmbeddedNetData) ":\n"
+        ".incbin \"" EVALFILE "\"\n"
+        ".globl " ASTRA_NET_SYMBOL(gEmbeddedNetEnd) "\n"
+        ASTRA_NET_SYMBOL(gEmbeddedNetEnd) ":\n"
+        ".byte 0\n"
+        ".text\n");
+
+extern "C" const unsigned char gEmbeddedNetData[];
+extern "C" const unsigned char gEmbeddedNetEnd[];
+#endif
+
+namespace NNUE {
+
+    /*
+     * Network File Format
+     *
+     * A header of NET_HEADER_SIZE bytes, followed by the Network struct exactly as it is laid out
+     * in memory. The weights are stored pre-permuted, so no conversion is needed after reading.
+     */
+    struct NetHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t inputSize;
+        uint32_t l1Size;
+        uint32_t l2Size;
+        uint32_t l3Size;
+    };
+
+    constexpr char NET_MAGIC[4] = {'A', 'N', 'N', 'U'};
+    constexpr uint32_t NET_VERSION = 2;
+    constexpr std::size_t NET_HEADER_SIZE = 64;
+
+    // the network in use, points either into the embedded net, a mapped file or ownedNetwork
+    static const Network *network = nullptr;
+
+    static std::unique_ptr<Network> ownedNetwork;
+    static void *netMapping = nullptr;
+    static std::size_t netMappingSize = 0;
+
+    // checks the header of a network in memory
+    static bool validateNetwork(const char *data, std::size_t size, const std::string &name) {
+        NetHeader header{};
+
+        if (size < NET_HEADER_SIZE) {
+            std::cerr << name << " is not a network file" << std::endl;
+            return false;
+        }
+
+        std::memcpy(&header, data, sizeof(header));
+
+        if (std::memcmp(header.magic, NET_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != NET_VERSION ||
+            header.inputSize != INPUT_SIZE || header.l1Size != L1_SIZE ||
+            header.l2Size != L2_SIZE || header.l3Size != L3_SIZE) {
+            std::cerr << name << " doesn't match the network architecture" << std::endl;
+            return false;
+        }
+
+        if (size < NET_HEADER_SIZE + sizeof(Network)) {
+            std::cerr << name << " is truncated" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    static void releaseNetwork() {
+#ifdef ASTRA_POSIX
+        if (netMapping) {
+            munmap(netMapping, netMappingSize);
+        }
+#endif
+        netMapping = nullptr;
+        netMappingSize = 0;
+        ownedNetwork.reset();
+        network = nullptr;
+    }
+
+    bool loadEmbeddedNetwork() {
+#ifdef ASTRA_EMBEDDED_NET
+        const auto *data = reinterpret_cast<const char *>(gEmbeddedNetData);
+        const auto size = std::size_t(gEmbeddedNetEnd - gEmbeddedNetData);
+
+        if (!validateNetwork(data, size, "embedded network")) {
+            return false;
+        }
+
+        releaseNetwork();
+        network = reinterpret_cast<const Network *>(data + NET_HEADER_SIZE);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool loadNetwork(const std::string &path) {
+#ifdef ASTRA_POSIX
+        // the file is mapped read only, pages are loaded on first use and shared
+        // with every other process that maps the same network
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            std::cerr << "Failed to open network " << path << std::endl;
+            return false;
+        }
+
+        struct stat st{};
+        void *mem = MAP_FAILED;
+
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            mem = mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+
+        close(fd);
+
+        if (mem == MAP_FAILED) {
+            std::cerr << "Failed to map network " << path << std::endl;
+            return false;
+        }
+
+        const auto size = std::size_t(st.st_size);
+        if (!validateNetwork(static_cast<const char *>(mem), size, path)) {
+            munmap(mem, size);
+            return false;
+        }
+
+        releaseNetwork();
+        netMapping = mem;
+        netMappingSize = size;
+        network = reinterpret_cast<const Network *>(static_cast<const char *>(mem) + NET_HEADER_SIZE);
+        return true;
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open network " << path << std::endl;
+            return false;
+        }
+
+        char headerBlock[NET_HEADER_SIZE];
+        if (!file.read(headerBlock, NET_HEADER_SIZE) ||
+            !validateNetwork(headerBlock, NET_HEADER_SIZE + sizeof(Network), path)) {
+            return false;
+        }
+
+        auto net = std::make_unique<Network>();
+        if (!file.read(reinterpret_cast<char *>(net.get()), sizeof(Network))) {
+            std::cerr << path << " is truncated" << std::endl;
+            return false;
+        }
+
+        releaseNetwork();
+        ownedNetwork = std::move(net);
+        network = ownedNetwork.get();
+        return true;
+#endif
+    }
+
+    bool isLoaded() {
+        return network != nullptr;
+    }
+
+    /*
+     * Hidden Layers
+     */
+
+    // clips the accumulator of both perspectives to [0, ACTIVATION_RANGE], side to move first
+    static void clippedFeatures(const Accumulator &acc, Color stm, uint8_t *output) {
+        for (int p = 0; p < NUM_COLORS; ++p) {
+            const int16_t *values = acc.values[p == 0 ? stm : ~stm];
+
+            for (int i = 0; i < L1_SIZE; ++i) {
+                output[p * L1_SIZE + i] = uint8_t(std::clamp<int>(values[i], 0, ACTIVATION_RANGE));
+            }
+        }
+    }
+
+    // collects the indices of all input chunks which contain at least one non-zero value.
+    // after the clipped relu most of the inputs are zero, so only a few chunks remain
+    static int findNonZeroChunks(const uint8_t *input, uint16_t *indices) {
+        int count = 0;
+
+#if defined(__AVX2__)
+        const __m256i zero = _mm256_setzero_si256();
+
+        // each 32 bit lane is one chunk, the values are at most 127, so a chunk
+        // is non-zero exactly when its lane compares greater than zero
+        for (int i = 0; i < L1_INPUT_SIZE; i += 32) {
+            const __m256i in = _mm256_load_si256(reinterpret_cast<const __m256i *>(input + i));
+            U64 mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(in, zero)));
+
+            while (mask) {
+                indices[count++] = uint16_t(i / L1_CHUNK_SIZE + popLsb(mask));
+            }
+        }
+#else
+        for (int i = 0; i < L1_NUM_CHUNKS; ++i) {
+            uint32_t chunk;
+            std::memcpy(&chunk, input + i * L1_CHUNK_SIZE, sizeof(chunk));
+
+            if (chunk) {
+                indices[count++] = uint16_t(i);
+            }
+        }
+#endif
+
+        return count;
+    }
+
+    // first hidden layer, only the columns of the non-zero input chunks are multiplied
+    static void sparseL1(const uint8_t *input, int32_t *output) {
+        alignas(64) uint16_t indices[L1_NUM_CHUNKS];
+        const int count = findNonZeroChunks(input, indices);
+
+#if defined(__AVX2__)
+        static_assert(L2_SIZE == 16, "the avx2 kernel computes 16 outputs in two registers");
+
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i sum0 = _mm256_load_si256(reinterpret_cast<const __m256i *>(network->l1Biases));
+        __m256i sum1 = _mm256_load_si256(reinterpret_cast<const __m256i *>(network->l1Biases + 8));
+
+        for (int k = 0; k < count; ++k) {
+            const int chunk = indices[k];
+
+            int32_t in32;
+            std::memcpy(&in32, input + chunk * L1_CHUNK_SIZE, sizeof(in32));
+
+            const __m256i in = _mm256_set1_epi32(in32);
+            const auto *weights = reinterpret_cast<const __m256i *>(network->l1Weights + chunk * L2_SIZE * L1_CHUNK_SIZE);
+
+            // u8 x i8 products summed in pairs, then in pairs again, gives one
+            // int32 dot product of 4 inputs per output lane
+            sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(_mm256_maddubs_epi16(in, _mm256_load_si256(weights)), ones));
+            sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(_mm256_maddubs_epi16(in, _mm256_load_si256(weights + 1)), ones));
+        }
+
+        _mm256_store_si256(reinterpret_cast<__m256i *>(output), sum0);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(output + 8), sum1);
+#else
+        std::copy(network->l1Biases, network->l1Biases + L2_SIZE, output);
+
+        for (int k = 0; k < count; ++k) {
+            const int chunk = indices[k];
+            const uint8_t *in = input + chunk * L1_CHUNK_SIZE;
+            const int8_t *weights = network->l1Weights + chunk * L2_SIZE * L1_CHUNK_SIZE;
+
+            for (int o = 0; o < L2_SIZE; ++o) {
+                for (int j = 0; j < L1_CHUNK_SIZE; ++j) {
+                    output[o] += in[j] * weights[o * L1_CHUNK_SIZE + j];
+                }
+            }
+        }
+#endif
+    }
+
+    // scales the layer output back and clips it to [0, ACTIVATION_RANGE]
+    template<int Size>
+    static void clippedRelu(const int32_t *input, uint8_t *output) {
+        for (int i = 0; i < Size; ++i) {
+            output[i] = uint8_t(std::clamp(input[i] >> WEIGHT_SHIFT, 0, ACTIVATION_RANGE));
+        }
+    }
+
+    int forward(const Accumulator &acc, Color stm) {
+        alignas(64) uint8_t features[L1_INPUT_SIZE];
+        alignas(64) int32_t l1Out[L2_SIZE];
+        alignas(64) uint8_t l2In[L2_SIZE];
+        alignas(64) int32_t l2Out[L3_SIZE];
+        alignas(64) uint8_t outIn[L3_SIZE];
+
+        clippedFeatures(acc, stm, features);
+
+        sparseL1(features, l1Out);
+        clippedRelu<L2_SIZE>(l1Out, l2In);
+
+        // the remaining layers are small and dense
+        for (int o = 0; o < L3_SIZE; ++o) {
+            int32_t sum = network->l2Biases[o];
+            for (int i = 0; i < L2_SIZE; ++i) {
+                sum += l2In[i] * network->l2Weights[o * L2_SIZE + i];
+            }
+            l2Out[o] = sum;
+        }
+        clippedRelu<L3_SIZE>(l2Out, outIn);
+
+        int32_t output = network->outBias;
+        for (int i = 0; i < L3_SIZE; ++i) {
+            output += outIn[i] * network->outWeights[i];
+        }
+
+        return output * OUTPUT_SCALE / (ACTIVATION_RANGE << WEIGHT_SHIFT);
+    }
+
+    /*
+     * Accumulators
+     */
+    void RefreshTable::reset() {
+        for (auto &perspective: entries) {
+            for (RefreshEntry &entry: perspective) {
+                std::copy(network->ftBiases, network->ftBiases + L1_SIZE, entry.values);
+                std::fill(entry.pieces, entry.pieces + NUM_PIECES, 0);
+            }
+        }
+    }
+
+    Accumulators::Accumulators() : stack(std::make_unique<Accumulator[]>(MAX_PLY * 2)),
+                                   refreshTable(std::make_unique<RefreshTable>()),
+                                   refreshes(0), refreshUpdates(0) {
+        if (isLoaded()) {
+            reset();
+        }
+    }
+
+    void Accumulators::reset() {
+        refreshTable->reset();
+
+        for (int i = 0; i < MAX_PLY * 2; ++i) {
+            stack[i].keys[WHITE] = stack[i].keys[BLACK] = 0;
+        }
+    }
+
+    int Accumulators::evaluate(const Board &board) {
+        materialize(board, WHITE);
+        materialize(board, BLACK);
+        return forward(stack[board.ply()], board.sideToMove());
+    }
+
+    // makes the accumulator of the current ply valid for the given perspective
+    void Accumulators::materialize(const Board &board, Color perspective) {
+        const int ply = board.ply();
+        if (stack[ply].keys[perspective] == board.getHash()) {
+            return;
+        }
+
+        const Square kingSq = board.kingSquare(perspective);
+        const Piece king = makePiece(perspective, KING);
+
+        // walk back to the closest computed ancestor, if our king changed its bucket
+        // or mirror state in between, every feature changed and we have to refresh
+        int start = ply;
+        while (true) {
+            const StateInfo &st = board.history[start];
+
+            if (start < ply && stack[start].keys[perspective] == st.hash) {
+                break;
+            }
+
+            bool kingCrossed = false;
+            for (int i = 0; i < st.numDirty; ++i) {
+                const DirtyPiece &dp = st.dirtyPieces[i];
+
+                if (dp.pc == king && (kingBucket(perspective, dp.from) != kingBucket(perspective, dp.to) ||
+                                      needsMirror(dp.from) != needsMirror(dp.to))) {
+                    kingCrossed = true;
+                }
+            }
+
+            if (kingCrossed || start == 0) {
+                refresh(board, stack[ply], perspective);
+                stack[ply].keys[perspective] = board.getHash();
+                return;
+            }
+
+            start--;
+        }
+
+        for (int i = start + 1; i <= ply; ++i) {
+            applyDirty(board.history[i], stack[i - 1], stack[i], perspective, kingSq);
+            stack[i].keys[perspective] = board.history[i].hash;
+        }
+    }
+
+    // computes the accumulator of a position from its parent and the pieces changed in between
+    void Accumulators::applyDirty(const StateInfo &st, const Accumulator &prev, Accumulator &acc,
+                                  Color perspective, Square kingSq) {
+        const int16_t *added[3];
+        const int16_t *removed[3];
+        int numAdded = 0, numRemoved = 0;
+
+        for (int i = 0; i < st.numDirty; ++i) {
+            const DirtyPiece &dp = st.dirtyPieces[i];
+
+            if (dp.from != NO_SQUARE) {
+                removed[numRemoved++] = network->ftWeights + featureIndex(perspective, kingSq, dp.pc, dp.from) * L1_SIZE;
+            }
+            if (dp.to != NO_SQUARE) {
+                added[numAdded++] = network->ftWeights + featureIndex(perspective, kingSq, dp.pc, dp.to) * L1_SIZE;
+            }
+        }
+
+        const int16_t *in = prev.values[perspective];
+        int16_t *out = acc.values[perspective];
+
+        for (int j = 0; j < L1_SIZE; ++j) {
+            int16_t value = in[j];
+
+            for (int i = 0; i < numAdded; ++i) {
+                value += added[i][j];
+            }
+            for (int i = 0; i < numRemoved; ++i) {
+                value -= removed[i][j];
+            }
+
+            out[j] = value;
+        }
+    }
+
+    // rebuilds the accumulator of one perspective from the refresh table entry of its king bucket
+    void Accumulators::refresh(const Board &board, Accumulator &acc, Color perspective) {
+        const Square kingSq = board.kingSquare(perspective);
+        const int index = kingBucket(perspective, kingSq) * 2 + needsMirror(kingSq);
+        RefreshEntry &entry = refreshTable->entries[perspective][index];
+
+        refreshes++;
+
+        for (int p = WHITE_PAWN; p <= BLACK_KING; ++p) {
+            const Piece pc = Piece(p);
+            const U64 pieces = board.pieceBitboard(colorOfPiece(pc), typeOfPiece(pc));
+
+            U64 removed = entry.pieces[pc] & ~pieces;
+            U64 added = pieces & ~entry.pieces[pc];
+
+            refreshUpdates += sparsePopCount(removed) + sparsePopCount(added);
+
+            while (removed) {
+                const int16_t *weights = network->ftWeights + featureIndex(perspective, kingSq, pc, popLsb(removed)) * L1_SIZE;
+                for (int i = 0; i < L1_SIZE; ++i) {
+                    entry.values[i] -= weights[i];
+                }
+            }
+
+            while (added) {
+                const int16_t *weights = network->ftWeights + featureIndex(perspective, kingSq, pc, popLsb(added)) * L1_SIZE;
+                for (int i = 0; i < L1_SIZE; ++i) {
+                    entry.values[i] += weights[i];
+                }
+            }
+
+            entry.pieces[pc] = pieces;
+        }
+
+        std::copy(entry.values, entry.values + L1_SIZE, acc.values[perspective]);
+    }
+
+    /*
+     * Batched Evaluation
+     *
+     * The feature transformer of a batch is a sparse times dense matrix product. Positions are
+     * processed in blocks, and every block is computed tile by tile over the accumulator columns,
+     * so the weight slices of the features used in a block stay in cache while all positions of
+     * the block read them.
+     */
+    constexpr int BATCH_BLOCK_SIZE = 64;
+    constexpr int BATCH_TILE_SIZE = 256;
+
+    bool collectFeatures(const PackedPosition &pos, PositionFeatures &features) {
+        features.count = 0;
+
+        // positions of a file are not validated, the king buckets need exactly one king per side
+        if (!pos.isValid()) {
+            return false;
+        }
+
+        Square kingSq[NUM_COLORS] = {NO_SQUARE, NO_SQUARE};
+
+        U64 occ = pos.occupancy;
+        for (int i = 0; occ; ++i) {
+            const Square s = popLsb(occ);
+            const Piece pc = pos.piece(i);
+
+            if (typeOfPiece(pc) == KING) {
+                kingSq[colorOfPiece(pc)] = s;
+            }
+        }
+
+        occ = pos.occupancy;
+        for (int i = 0; occ; ++i) {
+            const Square s = popLsb(occ);
+            const Piece pc = pos.piece(i);
+
+            features.indices[WHITE][i] = uint16_t(featureIndex(WHITE, kingSq[WHITE], pc, s));
+            features.indices[BLACK][i] = uint16_t(featureIndex(BLACK, kingSq[BLACK], pc, s));
+            features.count++;
+        }
+
+        return true;
+    }
+
+    // returns the number of invalid positions of the block
+    static int evaluateBlock(const PackedPosition *positions, int16_t *scores, int count,
+                             PositionFeatures *features, Accumulator *accumulators) {
+        bool valid[BATCH_BLOCK_SIZE];
+        int invalid = 0;
+
+        for (int p = 0; p < count; ++p) {
+            valid[p] = collectFeatures(positions[p], features[p]);
+            invalid += !valid[p];
+        }
+
+        for (int tile = 0; tile < L1_SIZE; tile += BATCH_TILE_SIZE) {
+            for (int p = 0; p < count; ++p) {
+                for (Color perspective: {WHITE, BLACK}) {
+                    // a local tile lets the compiler keep the sums in registers
+                    alignas(64) int16_t values[BATCH_TILE_SIZE];
+                    std::copy(network->ftBiases + tile, network->ftBiases + tile + BATCH_TILE_SIZE, values);
+
+                    for (int f = 0; f < features[p].count; ++f) {
+                        const int16_t *weights = network->ftWeights + features[p].indices[perspective][f] * L1_SIZE + tile;
+                        for (int i = 0; i < BATCH_TILE_SIZE; ++i) {
+                            values[i] += weights[i];
+                        }
+                    }
+
+                    std::copy(values, values + BATCH_TILE_SIZE, accumulators[p].values[perspective] + tile);
+                }
+            }
+        }
+
+        for (int p = 0; p < count; ++p) {
+            const int score = valid[p] ? forward(accumulators[p], positions[p].sideToMove()) : 0;
+            scores[p] = int16_t(std::clamp(score, -32767, 32767));
+        }
+
+        return invalid;
+    }
+
+    std::size_t evaluateBatch(const PackedPosition *positions, int16_t *scores, std::size_t count, int numThreads) {
+        const std::size_t numBlocks = (count + BATCH_BLOCK_SIZE - 1) / BATCH_BLOCK_SIZE;
+        std::atomic<std::size_t> nextBlock{0};
+        std::atomic<std::size_t> invalid{0};
+
+        auto worker = [&]() {
+            auto features = std::make_unique<PositionFeatures[]>(BATCH_BLOCK_SIZE);
+            auto accumulators = std::make_unique<Accumulator[]>(BATCH_BLOCK_SIZE);
+
+            for (std::size_t block = nextBlock++; block < numBlocks; block = nextBlock++) {
+                const std::size_t start = block * BATCH_BLOCK_SIZE;
+                const int size = int(std::min<std::size_t>(BATCH_BLOCK_SIZE, count - start));
+
+                invalid += evaluateBlock(positions + start, scores + start, size, features.get(), accumulators.get());
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int t = 1; t < numThreads; ++t) {
+            threads.emplace_back(worker);
+        }
+
+        worker();
+
+        for (std::thread &thread: threads) {
+            thread.join();
+        }
+
+        return invalid;
+    }
+
+} // namespace NNUE
@@ -0,0 +1,194 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_NNUE_H
+#define ASTRA_NNUE_H
+
+#include <memory>
+#include "../data/packedpos.h"
+
+namespace NNUE {
+
+    using namespace Chess;
+
+    /*
+     * Network Architecture
+     *
+     * (8 x 768 -> 1024) x 2 -> 16 -> 32 -> 1
+     *
+     * The inputs are king-bucketed: every perspective uses the 768 piece-square features of the
+     * bucket its own king is in. If the king stands on the e-h files, the board is mirrored
+     * horizontally, so only the a-d half needs buckets.
+     *
+     * The feature transformer is kept in int16 and updated per perspective.
+     * The clipped outputs of both perspectives are concatenated to 2048 uint8 values,
+     * all following layers use int8 weights with int32 accumulation.
+     */
+    constexpr int KING_BUCKETS = 8;
+    constexpr int INPUT_SIZE = KING_BUCKETS * 768;
+    constexpr int L1_SIZE = 1024;
+    constexpr int L2_SIZE = 16;
+    constexpr int L3_SIZE = 32;
+
+    // input size of the first hidden layer, both perspectives concatenated
+    constexpr int L1_INPUT_SIZE = 2 * L1_SIZE;
+
+    // the first hidden layer consumes its input in chunks of 4 bytes
+    constexpr int L1_CHUNK_SIZE = 4;
+    constexpr int L1_NUM_CHUNKS = L1_INPUT_SIZE / L1_CHUNK_SIZE;
+
+    // activations are clipped to [0, ACTIVATION_RANGE], which represents [0, 1]
+    constexpr int ACTIVATION_RANGE = 127;
+    // int8 weights of the hidden layers are scaled by 2^WEIGHT_SHIFT
+    constexpr int WEIGHT_SHIFT = 6;
+    // scales the network output to centipawns
+    constexpr int OUTPUT_SCALE = 400;
+
+    struct alignas(64) Network {
+        int16_t ftWeights[INPUT_SIZE * L1_SIZE];
+        int16_t ftBiases[L1_SIZE];
+
+        // stored as [chunk][output][4], so the weights of one input chunk are contiguous
+        int8_t l1Weights[L1_INPUT_SIZE * L2_SIZE];
+        int32_t l1Biases[L2_SIZE];
+
+        // stored as [output][input]
+        int8_t l2Weights[L2_SIZE * L3_SIZE];
+        int32_t l2Biases[L3_SIZE];
+
+        int8_t outWeights[L3_SIZE];
+        int32_t outBias;
+    };
+
+    struct alignas(64) Accumulator {
+        int16_t values[NUM_COLORS][L1_SIZE];
+
+        // hash of the position each perspective was computed for, the values
+        // only depend on the piece placement, so the hash identifies them
+        U64 keys[NUM_COLORS];
+    };
+
+    // uses the network compiled into the binary, if there is one
+    bool loadEmbeddedNetwork();
+    // maps an external network file, replacing the current network
+    bool loadNetwork(const std::string &path);
+    bool isLoaded();
+
+    // king bucket of a king square relative to its own side, the e-h files are mirrored onto a-d
+    constexpr int KING_BUCKET[NUM_SQUARES] = {
+            0, 1, 2, 3, 3, 2, 1, 0,
+            4, 4, 5, 5, 5, 5, 4, 4,
+            6, 6, 6, 6, 6, 6, 6, 6,
+            7, 7, 7, 7, 7, 7, 7, 7,
+            7, 7, 7, 7, 7, 7, 7, 7,
+            7, 7, 7, 7, 7, 7, 7, 7,
+            7, 7, 7, 7, 7, 7, 7, 7,
+            7, 7, 7, 7, 7, 7, 7, 7,
+    };
+
+    inline int kingBucket(Color perspective, Square kingSq) {
+        return KING_BUCKET[relativeSquare(perspective, kingSq)];
+    }
+
+    inline bool needsMirror(Square kingSq) {
+        return squareFile(kingSq) >= FILE_E;
+    }
+
+    // index of a piece on a square as seen from the given perspective with its king on kingSq
+    inline int featureIndex(Color perspective, Square kingSq, Piece pc, Square s) {
+        const int side = colorOfPiece(pc) != perspective;
+        const int sq = relativeSquare(perspective, s) ^ (needsMirror(kingSq) ? 7 : 0);
+        return kingBucket(perspective, kingSq) * 768 + side * 384 + typeOfPiece(pc) * 64 + sq;
+    }
+
+    /*
+     * Refresh Table
+     *
+     * Caches the last accumulator computed for each king bucket and mirror state, together with
+     * the piece bitboards it was computed for. An accumulator is rebuilt from the cached one
+     * by only applying the pieces that differ, instead of summing up all pieces from scratch.
+     */
+    struct alignas(64) RefreshEntry {
+        int16_t values[L1_SIZE];
+        U64 pieces[NUM_PIECES];
+    };
+
+    struct RefreshTable {
+        RefreshEntry entries[NUM_COLORS][KING_BUCKETS * 2];
+
+        void reset();
+    };
+
+    /*
+     * Holds the accumulator state of one search thread.
+     *
+     * There is one accumulator per game ply. Moves only record which pieces changed (see StateInfo),
+     * the accumulator of a position is materialized when it is evaluated: starting from the
+     * closest computed ancestor, the recorded changes are applied ply by ply. Positions that are
+     * never evaluated, e.g. because of a tt cutoff, never cost any accumulator work.
+     */
+    class Accumulators {
+    public:
+        Accumulators();
+
+        // returns the evaluation from the view of the side to move
+        int evaluate(const Board &board);
+
+        // clears the refresh table, must be called when a new network is loaded
+        void reset();
+
+        U64 refreshCount() const { return refreshes; }
+        U64 refreshUpdateCount() const { return refreshUpdates; }
+
+    private:
+        std::unique_ptr<Accumulator[]> stack;
+        std::unique_ptr<RefreshTable> refreshTable;
+
+        // number of refreshes and features added or removed by them
+        U64 refreshes;
+        U64 refreshUpdates;
+
+        void materialize(const Board &board, Color perspective);
+
+        void applyDirty(const StateInfo &st, const Accumulator &prev, Accumulator &acc,
+                        Color perspective, Square kingSq);
+
+        void refresh(const Board &board, Accumulator &acc, Color perspective);
+    };
+
+    // propagates the accumulator through the hidden layers
+    int forward(const Accumulator &acc, Color stm);
+
+    // active features of a position, indices[c][i] is the feature of the i-th occupied square
+    // from the perspective of c
+    struct PositionFeatures {
+        uint16_t indices[NUM_COLORS][32];
+        int count;
+    };
+
+    // returns false if the position is not valid, see PackedPosition::isValid
+    bool collectFeatures(const PackedPosition &pos, PositionFeatures &features);
+
+    // evaluates count positions with numThreads threads, the scores are from the view of
+    // the side to move of each position, for scoring whole datasets at once. Invalid positions
+    // get a score of 0, the number of them is returned
+    std::size_t evaluateBatch(const PackedPosition *positions, int16_t *scores, std::size_t count, int numThreads);
+
+} // namespace NNUE
+
+#endif //ASTRA_NNUE_H
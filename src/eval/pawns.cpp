@@ -0,0 +1,181 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "pawns.h"
+
+namespace Eval {
+
+    /*
+     * Pawn Structure Weights
+     */
+    constexpr int DOUBLED_MG = -10, DOUBLED_EG = -20;
+    constexpr int ISOLATED_MG = -10, ISOLATED_EG = -15;
+    constexpr int BACKWARD_MG = -8, BACKWARD_EG = -10;
+
+    // indexed by the relative rank of the passed pawn
+    constexpr int PASSED_MG[8] = {0, 5, 10, 15, 25, 40, 60, 0};
+    constexpr int PASSED_EG[8] = {0, 10, 15, 25, 45, 70, 110, 0};
+
+    // for each own pawn one and two ranks in front of the king on the king file and its neighbours
+    constexpr int SHELTER_NEAR = 10;
+    constexpr int SHELTER_FAR = 5;
+
+    // per square of king distance to the stop square of a passed pawn, scaled by its relative rank
+    constexpr int PASSER_THEIR_KING_EG = 5;
+    constexpr int PASSER_OWN_KING_EG = -2;
+    constexpr int PASSER_KING_RANK[8] = {0, 0, 0, 1, 2, 3, 5, 0};
+
+    // files next to the file of the square
+    static U64 adjacentFiles(Square s) {
+        const File f = squareFile(s);
+        return (f > FILE_A ? MASK_FILE[f - 1] : 0) | (f < FILE_H ? MASK_FILE[f + 1] : 0);
+    }
+
+    // all ranks in front of the square from the view of the given color
+    static U64 forwardRanks(Color c, Square s) {
+        const Rank r = squareRank(s);
+        if (c == WHITE) {
+            return r == RANK_8 ? 0 : ~0ULL << 8 * (r + 1);
+        }
+
+        return (1ULL << 8 * r) - 1;
+    }
+
+    // squares on the same and the adjacent files in front of the square
+    static U64 passedSpan(Color c, Square s) {
+        return forwardRanks(c, s) & (MASK_FILE[squareFile(s)] | adjacentFiles(s));
+    }
+
+    // evaluates the pawns of one color, the scores are from the view of that color
+    static void evaluatePawns(const Board &board, Color c, int &mg, int &eg, U64 &passed) {
+        const U64 ours = board.pieceBitboard(c, PAWN);
+        const U64 theirs = board.pieceBitboard(~c, PAWN);
+
+        U64 pawns = ours;
+        while (pawns) {
+            const Square s = popLsb(pawns);
+            const U64 file = MASK_FILE[squareFile(s)];
+            const U64 neighbours = ours & adjacentFiles(s);
+
+            // only the rearmost pawn of a doubled pair is penalized
+            if (ours & file & forwardRanks(c, s)) {
+                mg += DOUBLED_MG;
+                eg += DOUBLED_EG;
+            }
+
+            if (!neighbours) {
+                mg += ISOLATED_MG;
+                eg += ISOLATED_EG;
+            } else if (!(neighbours & ~forwardRanks(c, s))) {
+                // no neighbour can support the pawn, and it cannot advance safely
+                const Square stop = s + relativeDir(c, NORTH);
+                if (theirs & pawnAttacks(c, stop)) {
+                    mg += BACKWARD_MG;
+                    eg += BACKWARD_EG;
+                }
+            }
+
+            if (!(theirs & passedSpan(c, s))) {
+                const Rank r = relativeRank(c, squareRank(s));
+                mg += PASSED_MG[r];
+                eg += PASSED_EG[r];
+                passed |= SQUARE_BB[s];
+            }
+        }
+    }
+
+    static int kingShelter(const Board &board, Color c, Square kingSq) {
+        const U64 ours = board.pieceBitboard(c, PAWN);
+        const U64 files = MASK_FILE[squareFile(kingSq)] | adjacentFiles(kingSq);
+        const Rank r = relativeRank(c, squareRank(kingSq));
+
+        if (r >= RANK_7) {
+            return 0;
+        }
+
+        const U64 near = MASK_RANK[relativeRank(c, Rank(r + 1))] & files;
+        const U64 far = r < RANK_6 ? MASK_RANK[relativeRank(c, Rank(r + 2))] & files : 0;
+        return SHELTER_NEAR * popCount(ours & near) + SHELTER_FAR * popCount(ours & far);
+    }
+
+    // a passed pawn is stronger in the endgame if the own king supports it and the enemy king
+    // is far from its path
+    static int passerKings(const Board &board, Color c, U64 passed, const Square kingSq[NUM_COLORS]) {
+        U64 pawns = passed & board.pieceBitboard(c, PAWN);
+        int eg = 0;
+
+        while (pawns) {
+            const Square s = popLsb(pawns);
+            const Square stop = s + relativeDir(c, NORTH);
+            const int weight = PASSER_KING_RANK[relativeRank(c, squareRank(s))];
+
+            eg += weight * (PASSER_THEIR_KING_EG * distance(kingSq[~c], stop) +
+                            PASSER_OWN_KING_EG * distance(kingSq[c], stop));
+        }
+
+        return eg;
+    }
+
+    PawnTable::PawnTable() : entries(new PawnEntry[SIZE]), probes(0), hits(0) {
+        clear();
+    }
+
+    void PawnTable::clear() {
+        for (int i = 0; i < SIZE; ++i) {
+            entries[i] = PawnEntry();
+            entries[i].kingSq[WHITE] = entries[i].kingSq[BLACK] = NO_SQUARE;
+        }
+    }
+
+    const PawnEntry &PawnTable::probe(const Board &board) {
+        const U64 key = board.getPawnHash();
+        PawnEntry &entry = entries[key & (SIZE - 1)];
+
+        probes++;
+        if (entry.key == key && entry.kingSq[WHITE] != NO_SQUARE) {
+            hits++;
+        } else {
+            int mg[NUM_COLORS] = {0, 0}, eg[NUM_COLORS] = {0, 0};
+            U64 passed = 0;
+
+            evaluatePawns(board, WHITE, mg[WHITE], eg[WHITE], passed);
+            evaluatePawns(board, BLACK, mg[BLACK], eg[BLACK], passed);
+
+            entry.key = key;
+            entry.mg = int16_t(mg[WHITE] - mg[BLACK]);
+            entry.eg = int16_t(eg[WHITE] - eg[BLACK]);
+            entry.passed = passed;
+            entry.kingSq[WHITE] = entry.kingSq[BLACK] = NO_SQUARE;
+        }
+
+        const Square wKing = board.kingSquare(WHITE);
+        const Square bKing = board.kingSquare(BLACK);
+        if (entry.kingSq[WHITE] != wKing || entry.kingSq[BLACK] != bKing) {
+            entry.shelter = int16_t(kingShelter(board, WHITE, wKing) - kingShelter(board, BLACK, bKing));
+
+            const Square kingSq[NUM_COLORS] = {wKing, bKing};
+            entry.passerKings = int16_t(passerKings(board, WHITE, entry.passed, kingSq) -
+                                        passerKings(board, BLACK, entry.passed, kingSq));
+            entry.kingSq[WHITE] = wKing;
+            entry.kingSq[BLACK] = bKing;
+        }
+
+        return entry;
+    }
+
+} // namespace Eval
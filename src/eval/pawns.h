@@ -0,0 +1,72 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_PAWNS_H
+#define ASTRA_PAWNS_H
+
+#include <memory>
+#include "../chess/board.h"
+
+namespace Eval {
+
+    using namespace Chess;
+
+    struct PawnEntry {
+        U64 key;
+        // pawn structure score from white's view
+        int16_t mg;
+        int16_t eg;
+        // midgame king shelter and endgame king distance to the passed pawns from white's view,
+        // valid for the king squares below
+        int16_t shelter;
+        int16_t passerKings;
+        uint8_t kingSq[NUM_COLORS];
+        U64 passed;
+    };
+
+    /*
+     * Pawn Hash Table
+     *
+     * The pawn structure only changes with pawn moves and captures, so its evaluation is cached
+     * by the pawn key of the board. The king shelter and the king distance to the passed pawns
+     * also depend on the king squares, they are recomputed from the cached entry if a king moved. Every search thread owns its own table.
+     */
+    class PawnTable {
+    public:
+        PawnTable();
+
+        // returns the entry of the current pawn structure, it is computed if it is not cached
+        const PawnEntry &probe(const Board &board);
+
+        void clear();
+
+        U64 probeCount() const { return probes; }
+        U64 hitCount() const { return hits; }
+
+    private:
+        static constexpr int SIZE = 8192;
+
+        std::unique_ptr<PawnEntry[]> entries;
+
+        U64 probes;
+        U64 hits;
+    };
+
+} // namespace Eval
+
+#endif //ASTRA_PAWNS_H
@@ -16,8 +16,14 @@
    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
-#include "genData.h"
+#include <thread>
 #include "chess/perft.h"
+#include "data/convert.h"
+#include "data/datagen.h"
+#include "data/features.h"
+#include "data/filter.h"
+#include "data/shuffle.h"
+#include "uci.h"
 #include "search/search.h"
 
 const std::string pieceNot[] = {"P", "N", "B", "R", "Q", "K", ""};
@@ -30,20 +36,160 @@ void printMoves() {
     std::cout << std::endl;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     initLookUpTables();
     zobrist::initZobristKeys();
+    NNUE::loadEmbeddedNetwork();
+
+    int hashSize = 16;
+    std::string shmName;
+    std::string ttLoadPath;
+    std::string ttSavePath;
+    std::string csvPath;
+    std::string outPath = "data.bin";
+    int numThreads = int(std::max(1u, std::thread::hardware_concurrency()));
+    Astra::DatagenOptions datagen;
+    datagen.numGames = 0;
+    std::string filterPath;
+    // memory of the duplicate filter in MB, 0 keeps duplicates
+    std::size_t dedupMemory = 0;
+    std::string shufflePath;
+    std::string featuresPath;
+    ShuffleOptions shuffle;
+    Astra::FilterOptions filter;
+
+    // a command can come before the options, e.g. uci --hash 256 or bench 12
+    std::string command;
+    int benchDepth = 10;
+    int firstOption = 1;
+
+    if (argc > 1 && argv[1][0] != '-') {
+        command = argv[1];
+        firstOption = 2;
+
+        if (command == "bench" && argc > 2 && argv[2][0] != '-') {
+            benchDepth = std::stoi(argv[2]);
+            firstOption = 3;
+        }
+    }
+
+    // options are given as pairs, e.g. --hash 256 --shm astra-tt
+    for (int i = firstOption; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+
+        if (option == "--hash") {
+            hashSize = std::stoi(argv[i + 1]);
+        } else if (option == "--shm") {
+            shmName = argv[i + 1];
+        } else if (option == "--evalfile") {
+            NNUE::loadNetwork(argv[i + 1]);
+        } else if (option == "--tt-load") {
+            ttLoadPath = argv[i + 1];
+        } else if (option == "--tt-save") {
+            ttSavePath = argv[i + 1];
+        } else if (option == "--convert") {
+            csvPath = argv[i + 1];
+        } else if (option == "--out") {
+            outPath = argv[i + 1];
+        } else if (option == "--threads") {
+            numThreads = std::stoi(argv[i + 1]);
+        } else if (option == "--datagen") {
+            datagen.numGames = std::stoull(argv[i + 1]);
+        } else if (option == "--nodes") {
+            datagen.nodes = std::stoull(argv[i + 1]);
+        } else if (option == "--random-plies") {
+            datagen.randomPlies = std::stoi(argv[i + 1]);
+        } else if (option == "--seed") {
+            datagen.seed = std::stoull(argv[i + 1]);
+            shuffle.seed = datagen.seed;
+        } else if (option == "--shuffle") {
+            shufflePath = argv[i + 1];
+        } else if (option == "--features") {
+            featuresPath = argv[i + 1];
+        } else if (option == "--memory") {
+            shuffle.memory = std::stoull(argv[i + 1]);
+        } else if (option == "--dedup") {
+            dedupMemory = std::stoull(argv[i + 1]);
+        } else if (option == "--format") {
+            datagen.gameRecords = std::string(argv[i + 1]) == "games";
+        } else if (option == "--filter") {
+            filterPath = argv[i + 1];
+        } else if (option == "--quiet-margin") {
+            filter.quietMargin = std::stoi(argv[i + 1]);
+        } else if (option == "--rescore-depth") {
+            filter.rescoreDepth = std::stoi(argv[i + 1]);
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+        }
+    }
+
+    // convert a csv dataset into packed positions, e.g. --convert data.csv --out data.bin --dedup 1024
+    if (!csvPath.empty()) {
+        ConvertStats stats;
+        return convertCsv(csvPath, outPath, numThreads, stats, dedupMemory) ? 0 : 1;
+    }
+
+    // play games against itself to generate training data, e.g. --datagen 10000 --nodes 5000 --threads 8
+    if (datagen.numGames > 0) {
+        datagen.outPath = outPath;
+        datagen.numThreads = numThreads;
+        datagen.hashSize = hashSize;
+        datagen.dedupMemory = dedupMemory;
+        return Astra::generateData(datagen) ? 0 : 1;
+    }
+
+    // shuffle a packed file larger than the memory, e.g. --shuffle data.bin --out shuffled.bin --memory 4096
+    if (!shufflePath.empty()) {
+        shuffle.numThreads = numThreads;
+        return shufflePositions(shufflePath, outPath, shuffle) ? 0 : 1;
+    }
+
+    // write the network features of every position for a trainer, e.g. --features data.bin --out data.ftr
+    if (!featuresPath.empty()) {
+        return exportFeatures(featuresPath, outPath, numThreads) ? 0 : 1;
+    }
 
-    // generate input for neural network
-    //saveNetInput(fenToInput(loadDataset(INT_MAX)));
+    // keep the quiet positions of a packed file, e.g. --filter data.bin --out quiet.bin --rescore-depth 8
+    if (!filterPath.empty()) {
+        filter.numThreads = numThreads;
+        filter.hashSize = hashSize;
+        Astra::FilterStats stats;
+        return Astra::filterPositions(filterPath, outPath, filter, stats) ? 0 : 1;
+    }
+
+    // search fixed positions to a fixed depth, the node count is a signature of the search
+    if (command == "bench") {
+        Astra::bench(benchDepth, hashSize);
+        return 0;
+    }
+
+    Astra::TTable tt(hashSize, shmName);
+
+    // continue from the results of a previous run
+    if (!ttLoadPath.empty()) {
+        tt.load(ttLoadPath);
+    }
+
+    if (command == "uci") {
+        Astra::UCI uci(tt, hashSize);
+        uci.loop();
+
+        if (!ttSavePath.empty()) {
+            tt.save(ttSavePath);
+        }
+        return 0;
+    }
 
     // test performance and correctness of move generation
     //testPerft(5);
 
+    // test performance and correctness of fen parsing and writing
+    //testFen();
+
     Board board(DEFAULT_FEN);
 
     while (true) {
-        Astra::Search search(board);
+        Astra::Search search(board, tt);
         Move bestMove = search.findBestMove();
 
         Piece pc = board.pieceAt(bestMove.from());
@@ -60,5 +206,9 @@ int main() {
 
     printMoves();
 
+    if (!ttSavePath.empty()) {
+        tt.save(ttSavePath);
+    }
+
     return 0;
 }
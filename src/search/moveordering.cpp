@@ -72,6 +72,20 @@ namespace Astra {
         return score;
     }
 
+    // returns false if the capture can't lose material, so its see score is not needed. that's the
+    // case if the victim is worth at least as much as the attacker, or if the opponent can't attack
+    // the square. theirAttacks must contain every square the opponent could attack after the capture
+    bool canLoseMaterial(Board &board, Move &move, U64 theirAttacks) {
+        // see counts the promoted piece as the attacker
+        if (isPromotion(move)) {
+            return true;
+        }
+
+        const int attacker = pieceValues[typeOfPiece(board.pieceAt(move.from()))];
+        const int victim = pieceValues[typeOfPiece(board.pieceAt(move.to()))];
+        return attacker > victim && (theirAttacks & SQUARE_BB[move.to()]);
+    }
+
     /*
      * Most Valuable Victim / Least Valuable Attacker
      */
@@ -135,12 +149,17 @@ namespace Astra {
 
         std::vector<int> scores(moves.size(), 0);
 
+        // our pieces are left out of the occupancy, because the capturing piece
+        // may open a line to the target square when it moves
+        const Color them = ~board.sideToMove();
+        const U64 theirAttacks = board.attackMap(them, board.occupancy(them));
+
         int moveCount = 0;
         for (Move move : moves) {
             if (ttHit && move == entry.move) {
                 scores[moveCount] = TT_SCORE;
             } if (isCapture(move)) {
-                const int seeScore = seeCapture(board, move);
+                const int seeScore = canLoseMaterial(board, move, theirAttacks) ? seeCapture(board, move) : 0;
                 const int mvvlvaScore = mvvlva(board, move);
                 scores[moveCount] = seeScore >= 0 ? CAPTURE_SCORE + mvvlvaScore : mvvlvaScore;
             } else if (move == killer1[ply]) {
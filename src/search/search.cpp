@@ -16,6 +16,8 @@
    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <cstdlib>
+#include <string>
 #include "search.h"
 
 namespace Astra {
@@ -26,16 +28,102 @@ namespace Astra {
     constexpr int RAZOR_MARGIN = 129; // used for razor pruning
     constexpr int FUTILITY_MARGIN = 68; // used for futility pruning
 
-    const int DELTA_PIECE_VALUES[] = {114, 281, 297, 512, 936, 0};
+    // en passant captures land on an empty square, the last value is the captured pawn
+    const int DELTA_PIECE_VALUES[] = {114, 281, 297, 512, 936, 0, 114};
 
-    Search::Search(Board &board) : board(board), tt(16), searchedNodes(0), ply(0) {
+    Search::Search(Board &board, TTable &tt) : searchedNodes(0), stopRequested(false), stopped(false),
+                                               completedDepth(0), ply(0), bestScore(0), printInfo(true),
+                                               board(board), tt(tt) {
         pvTable.reset();
         moveOrdering.clear();
     }
 
+    void Search::setBoard(const Board &board) {
+        this->board = board;
+        ply = 0;
+        stopRequested = false;
+    }
+
+    bool Search::setFen(std::string_view fen) {
+        ply = 0;
+        return board.setFen(fen);
+    }
+
+    void Search::clear() {
+        pvTable.reset();
+        moveOrdering.clear();
+    }
+
+    int Search::staticEval() {
+        return evaluate(board.getHash());
+    }
+
+    int Search::quiescence() {
+        limits = SearchLimits();
+        stopped = false;
+        searchedNodes = 0;
+        ply = 0;
+
+        return quiesceSearch(-VALUE_INFINITE, VALUE_INFINITE);
+    }
+
+    // uci score of a search result, mate scores are given in moves, negative if the side to move gets mated
+    static std::string uciScore(int score) {
+        if (std::abs(score) >= VALUE_MATE - MAX_PLY) {
+            const int moves = (VALUE_MATE - std::abs(score) + 1) / 2;
+            return "mate " + std::to_string(score > 0 ? moves : -moves);
+        }
+        return "cp " + std::to_string(score);
+    }
+
+    // checks if a limit of the search is reached, once it is the search stays stopped. The node
+    // limit only depends on the search itself, so node limited searches can be reproduced. The
+    // first iteration always completes, so there is a move to return even with tiny limits
+    bool Search::isStopped() {
+        if (!stopped && completedDepth > 0) {
+            stopped = stopRequested ||
+                      (limits.nodes != 0 && searchedNodes >= limits.nodes) ||
+                      (limits.time != 0 && timeManager.isTimeExceeded());
+        }
+        return stopped;
+    }
+
+    // makes the move and increases the ply, the tt entry of the resulting
+    // position is prefetched first, so the memory access overlaps with the move update
+    void Search::makeMove(const Move &move) {
+        tt.prefetch(board.keyAfter(move));
+        board.makeMove(move);
+        ply++;
+    }
+
+    // undoes the move and decreases the ply
+    void Search::unmakeMove(const Move &move) {
+        board.unmakeMove(move);
+        ply--;
+    }
+
+    // returns the static evaluation of the current position, a position which was evaluated
+    // before is taken from the tt or the eval cache instead of being evaluated again
+    int Search::evaluate(U64 hash) {
+        const Color stm = board.sideToMove();
+
+        int eval = tt.lookupEval(hash, stm);
+        if (eval != VALUE_NONE) {
+            return eval;
+        }
+
+        if (evalCache.probe(hash, stm, eval)) {
+            return eval;
+        }
+
+        eval = Eval::evaluate(board, accumulators, pawnTable, materialTable);
+        evalCache.store(hash, stm, eval);
+        return eval;
+    }
+
     int Search::quiesceSearch(int alpha, int beta) {
         // check if the search should be stopped
-        if (timeManager.isTimeExceeded() && timePerMove != 0) {
+        if (isStopped()) {
             return 0;
         }
 
@@ -57,7 +145,8 @@ namespace Astra {
 
         const Color stm = board.sideToMove();
         const bool inCheck = board.inCheck();
-        int bestScore = Eval::getEval(board);
+        const int staticEval = evaluate(hash);
+        int bestScore = staticEval;
 
         // Alpha-Beta Pruning
         if (bestScore >= beta) {
@@ -99,14 +188,17 @@ namespace Astra {
             searchedNodes++;
 
             // make move and increase ply
-            board.makeMove(move);
-            ply++;
+            makeMove(move);
 
             int score = -quiesceSearch(-beta, -alpha);
 
             // undo move and decrease ply
-            board.unmakeMove(move);
-            ply--;
+            unmakeMove(move);
+
+            // check if the search should be stopped
+            if (isStopped()) {
+                return 0;
+            }
 
             // update best score and best move
             if (score > bestScore) {
@@ -118,7 +210,7 @@ namespace Astra {
 
                     // store Transposition Entry
                     if (score >= beta) {
-                        tt.store(hash, bestMove, bestScore, 0, LOWER_BOUND);
+                        tt.store(hash, bestMove, bestScore, staticEval, stm, 0, LOWER_BOUND);
                         return bestScore;
                     }
                 }
@@ -136,7 +228,7 @@ namespace Astra {
         // store Transposition Entry
         if (bestMove != NULL_MOVE) {
             Bound ttBound = pvNode ? EXACT_BOUND : UPPER_BOUND;
-            tt.store(hash, bestMove, bestScore, 0, ttBound);
+            tt.store(hash, bestMove, bestScore, staticEval, stm, 0, ttBound);
         }
 
         return bestScore;
@@ -144,7 +236,7 @@ namespace Astra {
 
     int Search::negamax(int alpha, int beta, int depth) {
         // check if the search should be stopped
-        if (timeManager.isTimeExceeded() && timePerMove != 0) {
+        if (isStopped()) {
             return 0;
         }
 
@@ -183,9 +275,9 @@ namespace Astra {
 
         int staticEval;
         if (inCheck) {
-            staticEval = -VALUE_NONE;
+            staticEval = VALUE_NONE;
         } else {
-            staticEval = ttHit ? entry.score : Eval::getEval(board);
+            staticEval = evaluate(hash);
         }
 
         // Internal Iterative Deepening
@@ -285,8 +377,7 @@ namespace Astra {
             searchedNodes++;
 
             // make move and increase ply
-            board.makeMove(move);
-            ply++;
+            makeMove(move);
 
             // score of the current move
             int score;
@@ -313,11 +404,10 @@ namespace Astra {
             }
 
             // undo move and decrease ply
-            board.unmakeMove(move);
-            ply--;
+            unmakeMove(move);
 
             // check if the search should be stopped
-            if (timeManager.isTimeExceeded() && timePerMove != 0) {
+            if (isStopped()) {
                 return 0;
             }
 
@@ -333,7 +423,7 @@ namespace Astra {
                     // Beta Cut-off
                     if (score >= beta) {
                         // store Transposition Entry as lower bound
-                        tt.store(hash, bestMove, score, std::max(depth, 0), LOWER_BOUND);
+                        tt.store(hash, bestMove, score, staticEval, board.sideToMove(), std::max(depth, 0), LOWER_BOUND);
 
                         // update History and Killer Moves (if not a capture)
                         if (!moveIsCapture) {
@@ -358,12 +448,16 @@ namespace Astra {
             return VALUE_DRAW;
         }
 
-        // store Transposition Entry
-        if (bestMove != NULL_MOVE) {
-            Bound ttBound = pvNode ? EXACT_BOUND : UPPER_BOUND;
-            tt.store(hash, bestMove, bestScore, std::max(depth, 0), ttBound);
+        // all moves were pruned, the node fails low. Returning -VALUE_INFINITE would make
+        // the parent fail high with VALUE_INFINITE, which no aspiration window can hold
+        if (bestMove == NULL_MOVE) {
+            return alpha;
         }
 
+        // store Transposition Entry
+        Bound ttBound = pvNode ? EXACT_BOUND : UPPER_BOUND;
+        tt.store(hash, bestMove, bestScore, staticEval, board.sideToMove(), std::max(depth, 0), ttBound);
+
         // return the best score
         return bestScore;
     }
@@ -390,6 +484,10 @@ namespace Astra {
 
             value = negamax(alpha, beta, depth);
 
+            if (stopped) {
+                break;
+            }
+
             // adjust alpha, beta and window
             if (value <= alpha) {
                 beta = (alpha + beta) / 2;
@@ -408,16 +506,30 @@ namespace Astra {
 
     // time per move in ms
     Move Search::findBestMove(unsigned int timePerMove) {
-        this->timePerMove = timePerMove;
+        SearchLimits limits;
+        limits.time = timePerMove;
+        return findBestMove(limits);
+    }
+
+    Move Search::findBestMove(const SearchLimits &limits) {
+        this->limits = limits;
+        searchedNodes = 0;
+        stopped = false;
+        completedDepth = 0;
+
+        const int maxDepth = limits.depth > 0 ? std::min(limits.depth, MAX_DEPTH) : MAX_DEPTH;
 
         // set total time allowed for a game (in ms)
-        timeManager.setTimePerMove(timePerMove);
+        timeManager.setTimePerMove(limits.time);
+
+        // the time limit is for the whole search, not for every iteration
+        timeManager.start();
 
         int prevEval = 0;
+        Move bestMove = NULL_MOVE;
 
         // Iterative Deepening:
-        for (int depth = 1; depth <= MAX_DEPTH; ++depth) {
-            timeManager.start();
+        for (int depth = 1; depth <= maxDepth; ++depth) {
 
             // reset the pv table
             pvTable.reset();
@@ -426,15 +538,15 @@ namespace Astra {
             //int score = aspirationSearch(depth, prevEval);
             int score = aspirationSearch(depth, prevEval);
 
-            // DEBUG: print search info
-            std::cout << "info depth " << depth
-                      << " nodes " << searchedNodes
-                      << " score cp " << score
-                      << " pv " << pvTable(0)(0) << std::endl;
+            // an interrupted iteration is not trusted, its aborted subtrees
+            // returned 0, so the result of the last full iteration is used
+            if (isStopped()) {
+                if (bestMove == NULL_MOVE) {
+                    bestMove = pvTable(0)(0);
+                    bestScore = score;
+                }
 
-            // check if the search should be stopped
-            if (timeManager.isTimeExceeded() && timePerMove != 0) {
-                if (pvTable(0)(0) == NULL_MOVE) {
+                if (bestMove == NULL_MOVE) {
                     std::cerr << "info: No move found!" << std::endl;
                     exit(1);
                 }
@@ -442,12 +554,56 @@ namespace Astra {
                 break;
             }
 
+            bestMove = pvTable(0)(0);
+            bestScore = score;
             prevEval = score;
+            completedDepth = depth;
+
+            if (!printInfo) {
+                continue;
+            }
+
+            // DEBUG: print search info
+            std::cout << "info depth " << depth
+                      << " nodes " << searchedNodes
+                      << " score " << uciScore(score)
+                      << " pv " << pvTable(0)(0) << std::endl;
+        }
+
+        // the table statistics change little between iterations, they are printed once per search
+        if (printInfo) {
+            // DEBUG: print the eval cache hit rate
+            const U64 evalProbes = evalCache.probeCount();
+            std::cout << "info string evalcache hits " << evalCache.hitCount()
+                      << " probes " << evalProbes
+                      << " hitrate " << (evalProbes ? 100.0 * evalCache.hitCount() / evalProbes : 0) << "%"
+                      << std::endl;
+
+            // DEBUG: print the cost of the accumulator refreshes or the pawn and material table hit rates
+            if (NNUE::isLoaded()) {
+                const U64 refreshes = accumulators.refreshCount();
+                std::cout << "info string refreshes " << refreshes
+                          << " updates/refresh " << (refreshes ? double(accumulators.refreshUpdateCount()) / refreshes : 0)
+                          << std::endl;
+            } else {
+                const U64 probes = pawnTable.probeCount();
+                std::cout << "info string pawn hits " << pawnTable.hitCount()
+                          << " probes " << probes
+                          << " hitrate " << (probes ? 100.0 * pawnTable.hitCount() / probes : 0) << "%"
+                          << std::endl;
+
+                const U64 materialProbes = materialTable.probeCount();
+                std::cout << "info string material hits " << materialTable.hitCount()
+                          << " probes " << materialProbes
+                          << " hitrate " << (materialProbes ? 100.0 * materialTable.hitCount() / materialProbes : 0) << "%"
+                          << std::endl;
+            }
+
+            std::cout << std::endl;
         }
 
-        std::cout << std::endl;
         // return the best move
-        return pvTable(0)(0);
+        return bestMove;
     }
 
     void Search::printPv(int depth) {
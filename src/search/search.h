@@ -19,36 +19,89 @@
 #ifndef ASTRA_SEARCH_H
 #define ASTRA_SEARCH_H
 
+#include <atomic>
 #include "timemanager.h"
 #include "pvtable.h"
 #include "moveordering.h"
 #include "../eval/evaluate.h"
+#include "../eval/evalcache.h"
 
 namespace Astra {
 
+    // limits of a search, a limit of 0 means there is none
+    struct SearchLimits {
+        // time per move in ms
+        unsigned int time = 0;
+        U64 nodes = 0;
+        int depth = 0;
+    };
+
     class Search {
     public:
-        explicit Search(Board &board);
+        Search(Board &board, TTable &tt);
+
+        // sets the position of the next search and clears a stop request, the tables of the
+        // search are kept
+        void setBoard(const Board &board);
+        // same as setBoard without copying a board, returns false if the fen is invalid
+        bool setFen(std::string_view fen);
+
+        // clears the history and killer moves, which carry over from one search to the next
+        void clear();
+
+        Board &getBoard() { return board; }
+
+        // static evaluation and quiescence search score of the position, both from the view
+        // of the side to move
+        int staticEval();
+        int quiescence();
 
         void printPv(int depth);
 
         // set search time per move to 1000ms
         Move findBestMove(unsigned int timePerMove = 1000);
+        Move findBestMove(const SearchLimits &limits);
+
+        // score of the last search from the view of the side to move
+        int getScore() const { return bestScore; }
+        U64 getNodes() const { return searchedNodes; }
+
+        // the info lines of every iteration are printed by default
+        void setPrintInfo(bool print) { printInfo = print; }
+
+        // asks a search running on another thread to stop, it stops like at a limit
+        void stop() { stopRequested = true; }
 
     private:
         static constexpr int MAX_DEPTH = 64;
 
         U64 searchedNodes;
 
-        unsigned int timePerMove;
+        SearchLimits limits;
+        std::atomic<bool> stopRequested;
+        bool stopped;
+        int completedDepth;
         int ply;
+        int bestScore;
+        bool printInfo;
 
         Board board;
 
         TimeManager timeManager;
         PVTable pvTable;
-        TTable tt;
+        TTable &tt;
         MoveOrdering moveOrdering;
+        NNUE::Accumulators accumulators;
+        Eval::PawnTable pawnTable;
+        Eval::MaterialTable materialTable;
+        Eval::EvalCache evalCache;
+
+        bool isStopped();
+
+        void makeMove(const Move &move);
+        void unmakeMove(const Move &move);
+
+        int evaluate(U64 hash);
 
         int quiesceSearch(int alpha, int beta);
 
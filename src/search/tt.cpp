@@ -16,49 +16,341 @@
    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ASTRA_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include "tt.h"
 
 namespace Astra {
 
-    TTable::TTable(int sizeMB) {
-        U64 sizeBytes = sizeMB * 1024 * 1024;
-        std::size_t entrySize = sizeof(TTEntry);
+    // the table is aligned to the size of a large page, so the os can back it with huge pages
+    constexpr std::size_t TT_ALIGNMENT = 2 * 1024 * 1024;
+
+    // allocates memory aligned to 2MB and asks the os to back it with huge pages,
+    // if huge pages are not available the memory is still usable with normal pages
+    static void *alignedLargePageAlloc(std::size_t size) {
+        size = (size + TT_ALIGNMENT - 1) / TT_ALIGNMENT * TT_ALIGNMENT;
+
+#ifdef _WIN32
+        void *mem = _aligned_malloc(size, TT_ALIGNMENT);
+#else
+        void *mem = nullptr;
+        if (posix_memalign(&mem, TT_ALIGNMENT, size) != 0) {
+            mem = nullptr;
+        }
+#endif
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (mem) {
+            madvise(mem, size, MADV_HUGEPAGE);
+        }
+#endif
+
+        return mem;
+    }
+
+    static void alignedLargePageFree(void *mem) {
+#ifdef _WIN32
+        _aligned_free(mem);
+#else
+        free(mem);
+#endif
+    }
+
+    /*
+     * Table File Format
+     *
+     * A saved table starts with this header, padded with zeros to TT_FILE_HEADER_SIZE bytes,
+     * followed by the raw entries. Padding the header to a page keeps the entries page aligned,
+     * so they can be mapped straight from the file. The version has to be increased whenever
+     * the layout of PackedEntry changes.
+     */
+    struct TTFileHeader {
+        char magic[4];
+        uint32_t version;
+        U64 zobristSeed;
+        U64 entryCount;
+        U64 entrySize;
+    };
+
+    constexpr char TT_FILE_MAGIC[4] = {'A', 'T', 'T', 'S'};
+    constexpr uint32_t TT_FILE_VERSION = 2;
+    constexpr std::size_t TT_FILE_HEADER_SIZE = 4096;
+
+    TTable::TTable(int sizeMB, const std::string &shmName) : backing(Backing::HEAP), mapping(nullptr), mappingSize(0) {
+        U64 sizeBytes = U64(sizeMB) * 1024 * 1024;
+        std::size_t entrySize = sizeof(PackedEntry);
         ttSize = sizeBytes / entrySize;
 
-        try {
-            entries = new TTEntry[ttSize];
+        if (!shmName.empty()) {
+            entries = attachSharedMemory(shmName, ttSize * entrySize);
+
+            // a new segment is zero filled by the os, an existing one
+            // already contains the results of the other processes
+            if (entries) {
+                backing = Backing::SHARED_MEMORY;
+                mapping = entries;
+                mappingSize = ttSize * entrySize;
+                return;
+            }
+
+            std::cerr << "Falling back to a private transposition table" << std::endl;
+        }
 
-            for (int i = 0; i < ttSize; ++i)
-                entries[i] = TTEntry();
-        } catch (const std::bad_alloc &e) {
+        entries = static_cast<PackedEntry *>(alignedLargePageAlloc(ttSize * entrySize));
+
+        if (!entries) {
             std::cerr << "Failed to allocate transposition table" << std::endl;
-            std::cerr << "Error: " << e.what() << std::endl;
             exit(1);
         }
+
+        clear();
     }
 
     TTable::~TTable() {
-        delete[] entries;
+        release();
     }
 
+    void TTable::release() {
+#ifdef ASTRA_POSIX
+        if (backing != Backing::HEAP) {
+            munmap(mapping, mappingSize);
+            return;
+        }
+#endif
+        alignedLargePageFree(entries);
+    }
+
+    bool TTable::save(const std::string &path) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open " << path << std::endl;
+            return false;
+        }
+
+        TTFileHeader header{};
+        std::memcpy(header.magic, TT_FILE_MAGIC, sizeof(header.magic));
+        header.version = TT_FILE_VERSION;
+        header.zobristSeed = zobrist::SEED;
+        header.entryCount = ttSize;
+        header.entrySize = sizeof(PackedEntry);
+
+        std::vector<char> headerBlock(TT_FILE_HEADER_SIZE, 0);
+        std::memcpy(headerBlock.data(), &header, sizeof(header));
+
+        file.write(headerBlock.data(), std::streamsize(headerBlock.size()));
+        file.write(reinterpret_cast<const char *>(entries), std::streamsize(ttSize * sizeof(PackedEntry)));
+
+        if (!file) {
+            std::cerr << "Failed to write transposition table to " << path << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool TTable::load(const std::string &path) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            std::cerr << "Failed to open " << path << std::endl;
+            return false;
+        }
+
+        const auto fileSize = std::size_t(file.tellg());
+        file.seekg(0);
+
+        TTFileHeader header{};
+        if (fileSize < TT_FILE_HEADER_SIZE || !file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+            std::cerr << path << " is not a transposition table file" << std::endl;
+            return false;
+        }
+
+        // an empty table can't be probed and a count which overflows the size can't be mapped
+        const U64 maxEntries = (std::numeric_limits<std::size_t>::max() - TT_FILE_HEADER_SIZE) / sizeof(PackedEntry);
+
+        if (std::memcmp(header.magic, TT_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != TT_FILE_VERSION ||
+            header.entrySize != sizeof(PackedEntry) ||
+            header.entryCount == 0 || header.entryCount > maxEntries ||
+            fileSize != TT_FILE_HEADER_SIZE + header.entryCount * header.entrySize) {
+            std::cerr << path << " has an incompatible format" << std::endl;
+            return false;
+        }
+
+        if (header.zobristSeed != zobrist::SEED) {
+            std::cerr << path << " was saved with different zobrist keys" << std::endl;
+            return false;
+        }
+
+#ifdef ASTRA_POSIX
+        // a shared table keeps its segment, otherwise the file is mapped directly
+        if (backing != Backing::SHARED_MEMORY) {
+            const int fd = open(path.c_str(), O_RDONLY);
+            void *mem = fd == -1 ? MAP_FAILED : mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+            if (fd != -1) {
+                close(fd);
+            }
+
+            if (mem == MAP_FAILED) {
+                std::cerr << "Failed to map " << path << std::endl;
+                return false;
+            }
+
+            release();
+
+            backing = Backing::MAPPED_FILE;
+            mapping = mem;
+            mappingSize = fileSize;
+            ttSize = header.entryCount;
+            entries = reinterpret_cast<PackedEntry *>(static_cast<char *>(mem) + TT_FILE_HEADER_SIZE);
+            return true;
+        }
+#endif
+
+        if (header.entryCount != ttSize) {
+            std::cerr << path << " has a different hash size than the current table" << std::endl;
+            return false;
+        }
+
+        file.seekg(TT_FILE_HEADER_SIZE);
+        file.read(reinterpret_cast<char *>(entries), std::streamsize(ttSize * sizeof(PackedEntry)));
+
+        return bool(file);
+    }
+
+    // maps the named posix shared memory segment, creating it if it doesn't exist yet.
+    // every process using the same name and size works on the same table, the
+    // segment stays alive after the processes exit until it's removed from /dev/shm
+    PackedEntry *TTable::attachSharedMemory(const std::string &name, std::size_t size) {
+#ifdef ASTRA_POSIX
+        const std::string shmPath = name[0] == '/' ? name : "/" + name;
+
+        const int fd = shm_open(shmPath.c_str(), O_CREAT | O_RDWR, 0600);
+        if (fd == -1) {
+            std::cerr << "Failed to open shared memory " << shmPath << std::endl;
+            return nullptr;
+        }
+
+        struct stat st{};
+        if (fstat(fd, &st) == -1 || (st.st_size != 0 && std::size_t(st.st_size) != size)) {
+            std::cerr << "Shared memory " << shmPath << " exists with a different hash size" << std::endl;
+            close(fd);
+            return nullptr;
+        }
+
+        if (ftruncate(fd, off_t(size)) == -1) {
+            std::cerr << "Failed to resize shared memory " << shmPath << std::endl;
+            close(fd);
+            return nullptr;
+        }
+
+        void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (mem == MAP_FAILED) {
+            std::cerr << "Failed to map shared memory " << shmPath << std::endl;
+            return nullptr;
+        }
+
+        return static_cast<PackedEntry *>(mem);
+#else
+        std::cerr << "Shared memory transposition tables are not supported on this platform" << std::endl;
+        return nullptr;
+#endif
+    }
+
+    // clears the table in parallel, every thread touches its own slice first,
+    // so on numa systems the pages get placed on the node of the thread using them
+    void TTable::clear(int numThreads) {
+        if (numThreads <= 0) {
+            numThreads = int(std::max(1u, std::thread::hardware_concurrency()));
+        }
+
+        const U64 sliceSize = (ttSize + numThreads - 1) / numThreads;
+
+        std::vector<std::thread> threads;
+        for (U64 t = 0; t < U64(numThreads); ++t) {
+            threads.emplace_back([this, t, sliceSize]() {
+                const U64 start = t * sliceSize;
+                const U64 end = std::min(start + sliceSize, ttSize);
+
+                // an entry with all bytes set to zero is an empty entry
+                if (start < end) {
+                    std::memset(static_cast<void *>(entries + start), 0, (end - start) * sizeof(PackedEntry));
+                }
+            });
+        }
+
+        for (std::thread &thread: threads) {
+            thread.join();
+        }
+    }
+
+    // probing and storing never lock, relaxed atomics are enough
+    // since a torn entry is detected by the xored key
     bool TTable::lookup(TTEntry& entry, U64 hash, int depth) {
-        U64 index = hash % ttSize;
+        const PackedEntry &slot = entries[hash % ttSize];
+        const U64 key = slot.key.load(std::memory_order_relaxed);
+        const U64 data = slot.data.load(std::memory_order_relaxed);
 
-        if(entries[index].hash == hash && entries[index].bound != NO_BOUND && entries[index].depth >= depth) {
-            entry = entries[index];
+        if ((key ^ data) != hash) {
+            return false;
+        }
+
+        const TTEntry found = PackedEntry::unpack(hash, data);
+        if (found.bound != NO_BOUND && found.depth >= depth) {
+            entry = found;
             return true;
         }
 
         return false;
     }
 
-    void TTable::store(U64 hash, Move move, int score, int depth, Bound bound) {
-        U64 index = hash % ttSize;
+    int TTable::lookupEval(U64 hash, Color stm) const {
+        const PackedEntry &slot = entries[hash % ttSize];
+        const U64 key = slot.key.load(std::memory_order_relaxed);
+        const U64 data = slot.data.load(std::memory_order_relaxed);
 
-        if (entries[index].hash == hash && entries[index].depth > depth)
-            return;
+        if ((key ^ data) != hash) {
+            return VALUE_NONE;
+        }
+
+        const TTEntry found = PackedEntry::unpack(hash, data);
+        return found.evalStm == stm ? found.eval : VALUE_NONE;
+    }
+
+    void TTable::store(U64 hash, Move move, int score, int eval, Color stm, int depth, Bound bound) {
+        PackedEntry &slot = entries[hash % ttSize];
+        const U64 oldData = slot.data.load(std::memory_order_relaxed);
+        const U64 oldKey = slot.key.load(std::memory_order_relaxed) ^ oldData;
+
+        if (oldKey == hash) {
+            const TTEntry old = PackedEntry::unpack(hash, oldData);
+            if (old.depth > depth)
+                return;
+
+            // keep the static evaluation of the same position
+            if (eval == VALUE_NONE && old.eval != VALUE_NONE) {
+                eval = old.eval;
+                stm = old.evalStm;
+            }
+        }
 
-        entries[index] = TTEntry(hash, depth, move, score, bound);
+        const U64 data = PackedEntry::pack(move, score, eval, stm, depth, bound);
+        slot.key.store(hash ^ data, std::memory_order_relaxed);
+        slot.data.store(data, std::memory_order_relaxed);
     }
 
 } // namespace Astra
@@ -19,7 +19,8 @@
 #ifndef ASTRA_TT_H
 #define ASTRA_TT_H
 
-#include "../chess/types.h"
+#include <atomic>
+#include "../chess/zobrist.h"
 
 using namespace Chess;
 
@@ -37,27 +38,105 @@ namespace Astra {
         int depth;
         Move move;
         int score;
+        // static evaluation from the view of evalStm, VALUE_NONE if there is none
+        int eval;
+        Color evalStm;
         Bound bound;
 
-        TTEntry() : hash(0), depth(0), move(NULL_MOVE), score(0), bound(NO_BOUND) {}
+        TTEntry() : hash(0), depth(0), move(NULL_MOVE), score(0), eval(VALUE_NONE), evalStm(WHITE), bound(NO_BOUND) {}
 
-        TTEntry(U64 hash, int depth, Move move, int score, Bound bound) :
-                hash(hash), depth(depth), move(move), score(score), bound(bound) {}
+        TTEntry(U64 hash, int depth, Move move, int score, int eval, Color evalStm, Bound bound) :
+                hash(hash), depth(depth), move(move), score(score), eval(eval), evalStm(evalStm), bound(bound) {}
+    };
+
+    /*
+     * An entry as it is stored in the table, packed into two 64-bit words.
+     * The key is stored xored with the data, so if two threads write the same slot
+     * at once, the torn entry no longer matches its hash and is rejected on probing.
+     *
+     * data layout:
+     * bits  0-15: move
+     * bits 16-31: score
+     * bits 32-39: depth
+     * bits 40-41: bound
+     * bit     42: side to move of the static evaluation
+     * bits 48-63: static evaluation
+     *
+     * The hash does not include the side to move, after a null move the same hash belongs to the
+     * other side, so the static evaluation is only valid for the side it was computed for.
+     */
+    struct PackedEntry {
+        std::atomic<U64> key;
+        std::atomic<U64> data;
+
+        static U64 pack(Move move, int score, int eval, Color evalStm, int depth, Bound bound) {
+            return U64(move.to_from()) |
+                   U64(uint16_t(int16_t(score))) << 16 |
+                   U64(uint8_t(depth)) << 32 |
+                   U64(bound) << 40 |
+                   U64(evalStm) << 42 |
+                   U64(uint16_t(int16_t(eval))) << 48;
+        }
+
+        static TTEntry unpack(U64 hash, U64 data) {
+            return {hash,
+                    int(uint8_t(data >> 32)),
+                    Move(uint16_t(data)),
+                    int(int16_t(data >> 16)),
+                    int(int16_t(data >> 48)),
+                    Color(data >> 42 & 0x1),
+                    Bound(data >> 40 & 0x3)};
+        }
     };
 
     class TTable {
     public:
-        explicit TTable(int sizeMB);
+        // if a shared memory name is given, the table is shared with
+        // all other processes which use the same name
+        explicit TTable(int sizeMB, const std::string &shmName = "");
 
         ~TTable();
 
+        // clears the table with numThreads threads, 0 uses all hardware threads
+        void clear(int numThreads = 0);
+
+        // saves all entries with a header to a file, no search may run meanwhile
+        bool save(const std::string &path) const;
+
+        // maps a saved table copy-on-write into memory, the file itself is never modified
+        bool load(const std::string &path);
+
         bool lookup(TTEntry& entry, U64 hash, int depth);
 
-        void store(U64 hash, Move move, int score, int depth, Bound bound);
+        // returns the static evaluation stored for the hash and side to move, or VALUE_NONE
+        int lookupEval(U64 hash, Color stm) const;
+
+        // eval is the static evaluation from the view of stm, or VALUE_NONE if it is unknown
+        void store(U64 hash, Move move, int score, int eval, Color stm, int depth, Bound bound);
+
+        // hints the cpu to load the entry of the given hash into the cache
+        void prefetch(U64 hash) const {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(&entries[hash % ttSize]);
+#endif
+        }
 
     private:
+        enum class Backing {
+            HEAP, SHARED_MEMORY, MAPPED_FILE
+        };
+
         U64 ttSize;
-        TTEntry *entries;
+        PackedEntry *entries;
+        Backing backing;
+
+        // the whole mapping of a mapped file, including its header
+        void *mapping;
+        std::size_t mappingSize;
+
+        static PackedEntry *attachSharedMemory(const std::string &name, std::size_t size);
+
+        void release();
 
     };
 
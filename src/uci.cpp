@@ -0,0 +1,265 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "uci.h"
+
+namespace Astra {
+
+    // value of EvalFile for the network compiled into the binary
+    const std::string EMBEDDED_NET_NAME = "<embedded>";
+
+    // moves left in the game if the gui does not send movestogo
+    constexpr int MOVES_TO_GO = 25;
+    // time in ms a move keeps on the clock for the communication with the gui
+    constexpr int TIME_MARGIN = 50;
+
+    const std::vector<std::string> BENCH_FENS = {
+        DEFAULT_FEN,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+        "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+        "8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 3 54",
+    };
+
+    // finds the legal move of the uci string, NULL_MOVE if there is none
+    static Move parseMove(Board &board, const std::string &str) {
+        for (Move move: MoveList(board)) {
+            std::ostringstream ss;
+            ss << move;
+
+            if (ss.str() == str) {
+                return move;
+            }
+        }
+
+        return NULL_MOVE;
+    }
+
+    // the table is not cleared, it may hold the results of a previous run
+    UCI::UCI(TTable &tt, int hashSize) : tt(tt), hashSize(hashSize), board(DEFAULT_FEN), search(std::make_unique<Search>(board, tt)) {}
+
+    UCI::~UCI() {
+        waitForSearch();
+    }
+
+    // returns once a running search has printed its bestmove
+    void UCI::waitForSearch() {
+        if (searchThread.joinable()) {
+            searchThread.join();
+        }
+    }
+
+    // clears everything a search learned, so the next searches do not depend on earlier ones
+    void UCI::newGame() {
+        tt.clear();
+        search = std::make_unique<Search>(board, tt);
+    }
+
+    void UCI::position(std::istringstream &is) {
+        std::string token, fen;
+        is >> token;
+
+        if (token == "startpos") {
+            fen = DEFAULT_FEN;
+            is >> token;
+        } else if (token == "fen") {
+            while (is >> token && token != "moves") {
+                fen += token + " ";
+            }
+        } else {
+            return;
+        }
+
+        if (!board.setFen(fen)) {
+            std::cout << "info string invalid fen " << fen << std::endl;
+            return;
+        }
+
+        while (is >> token) {
+            const Move move = parseMove(board, token);
+            if (move == NULL_MOVE) {
+                std::cout << "info string illegal move " << token << std::endl;
+                return;
+            }
+
+            // keep room in the history for the search
+            if (board.ply() >= MAX_PLY) {
+                board.resetHistory();
+            }
+
+            board.makeMove(move);
+        }
+    }
+
+    // setoption name <name> value <value>, both may contain spaces
+    void UCI::setOption(std::istringstream &is) {
+        std::string token, name, value;
+        is >> token;
+
+        while (is >> token && token != "value") {
+            name += (name.empty() ? "" : " ") + token;
+        }
+        while (is >> token) {
+            value += (value.empty() ? "" : " ") + token;
+        }
+
+        if (name == "EvalFile") {
+            const bool loaded = value == EMBEDDED_NET_NAME ? NNUE::loadEmbeddedNetwork() : NNUE::loadNetwork(value);
+            if (!loaded) {
+                std::cout << "info string could not load network " << value << std::endl;
+                return;
+            }
+
+            // the tables and accumulators hold evaluations of the previous network
+            newGame();
+        } else {
+            std::cout << "info string unknown option " << name << std::endl;
+        }
+    }
+
+    void UCI::go(std::istringstream &is) {
+        SearchLimits limits;
+        std::string token;
+
+        int clock[2] = {0, 0}, increment[2] = {0, 0};
+        int movesToGo = 0;
+        bool infinite = false;
+
+        while (is >> token) {
+            if (token == "nodes") {
+                is >> limits.nodes;
+            } else if (token == "depth") {
+                is >> limits.depth;
+            } else if (token == "movetime") {
+                is >> limits.time;
+            } else if (token == "wtime") {
+                is >> clock[WHITE];
+            } else if (token == "btime") {
+                is >> clock[BLACK];
+            } else if (token == "winc") {
+                is >> increment[WHITE];
+            } else if (token == "binc") {
+                is >> increment[BLACK];
+            } else if (token == "movestogo") {
+                is >> movesToGo;
+            } else if (token == "infinite") {
+                infinite = true;
+            }
+        }
+
+        // with a clock the move gets an even share of the remaining time and half of the increment,
+        // it always keeps a margin for the overhead of the gui
+        const Color stm = board.sideToMove();
+        if (limits.time == 0 && clock[stm] > 0) {
+            const int share = clock[stm] / (movesToGo > 0 ? movesToGo : MOVES_TO_GO) + increment[stm] / 2;
+            limits.time = std::max(1, std::min(share, clock[stm] - TIME_MARGIN));
+        }
+
+        // without any limit the search gets one second
+        if (!infinite && limits.nodes == 0 && limits.depth == 0 && limits.time == 0) {
+            limits.time = 1000;
+        }
+
+        // the board is copied before the thread starts, so position can't change it during the search
+        search->setBoard(board);
+        searchThread = std::thread([this, limits]() {
+            const Move bestMove = search->findBestMove(limits);
+            std::cout << "bestmove " << bestMove << std::endl;
+        });
+    }
+
+    void UCI::loop() {
+        std::string line, token;
+
+        while (std::getline(std::cin, line)) {
+            std::istringstream is(line);
+            token.clear();
+            is >> token;
+
+            if (token == "quit") {
+                search->stop();
+                break;
+            } else if (token == "stop") {
+                search->stop();
+                waitForSearch();
+                continue;
+            } else if (token == "isready") {
+                std::cout << "readyok" << std::endl;
+                continue;
+            }
+
+            // every other command changes the state of the search, it waits until it is done
+            waitForSearch();
+
+            if (token == "uci") {
+                std::cout << "id name Astra\nid author Semih Oezalp\n"
+                          << "option name EvalFile type string default " << EMBEDDED_NET_NAME << "\nuciok" << std::endl;
+            } else if (token == "ucinewgame") {
+                newGame();
+            } else if (token == "setoption") {
+                setOption(is);
+            } else if (token == "position") {
+                position(is);
+            } else if (token == "go") {
+                go(is);
+            } else if (token == "bench") {
+                int depth = 10;
+                is >> depth;
+                bench(depth, hashSize);
+            } else if (!token.empty()) {
+                std::cout << "info string unknown command " << token << std::endl;
+            }
+        }
+
+        waitForSearch();
+    }
+
+    void bench(int depth, int hashSize) {
+        TTable tt(hashSize);
+        U64 nodes = 0;
+
+        SearchLimits limits;
+        limits.depth = depth;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (const std::string &fen: BENCH_FENS) {
+            Board board(fen);
+            tt.clear();
+
+            Search search(board, tt);
+            search.setPrintInfo(false);
+
+            const Move bestMove = search.findBestMove(limits);
+            nodes += search.getNodes();
+
+            std::cout << "bestmove " << bestMove << " score " << search.getScore()
+                      << " nodes " << search.getNodes() << " fen " << fen << std::endl;
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "\nNodes searched: " << nodes
+                  << "\nNodes/second: " << U64(nodes / std::max(seconds, 1e-9)) << std::endl;
+    }
+
+} // namespace Astra
@@ -0,0 +1,69 @@
+/*
+   Astra is a chess engine written in C++
+   Copyright (C) 2024 Semih Özalp
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASTRA_UCI_H
+#define ASTRA_UCI_H
+
+#include <memory>
+#include <thread>
+#include "search/search.h"
+
+namespace Astra {
+
+    /*
+     * UCI
+     *
+     * Reads commands from stdin until quit. Supported are uci, isready, ucinewgame,
+     * setoption name EvalFile value <path>|<embedded>, position startpos|fen <fen> [moves ...],
+     * go [nodes <n>] [depth <d>] [movetime <ms>] [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>]
+     * [movestogo <n>] [infinite], stop and bench [depth]. bench uses the hash size of the engine.
+     *
+     * go searches on its own thread, so stop, quit and isready are answered during a search. Other
+     * commands wait until the search has printed its bestmove. go infinite searches until stop.
+     *
+     * With one thread and the same hash size, a sequence of node or depth limited searches
+     * gives the same moves, scores and node counts on every run.
+     */
+    class UCI {
+    public:
+        UCI(TTable &tt, int hashSize);
+        ~UCI();
+
+        void loop();
+
+    private:
+        TTable &tt;
+        int hashSize;
+        Board board;
+        std::unique_ptr<Search> search;
+        std::thread searchThread;
+
+        void waitForSearch();
+        void newGame();
+        void setOption(std::istringstream &is);
+        void position(std::istringstream &is);
+        void go(std::istringstream &is);
+    };
+
+    // searches a fixed set of positions to the given depth, each with a cleared table, and prints
+    // the total number of nodes. The node count changes only if the search itself changes
+    void bench(int depth, int hashSize);
+
+} // namespace Astra
+
+#endif //ASTRA_UCI_H